@@ -2,37 +2,131 @@
 // Created by Joe Yu on 4/24/23.
 //
 #include "BigInteger.h"
+#include "Instrumentation.h"
+#include "LimbArithmetic.h"
 
-BigInteger BigInteger::operator+(const BigInteger &h) const {
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using instrumentation::Operation;
+using instrumentation::ScopedOperation;
+using limbs::limb_t;
+
+namespace {
+    constexpr bool LITTLE_ENDIAN_HOST = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+
+    // k for a radix 2^k with 1 <= k <= 6, 0 for any other radix
+    unsigned radixBits(unsigned radix) {
+        if (radix < 2 || radix > 64 || (radix & (radix - 1)) != 0) return 0;
+        return static_cast<unsigned>(__builtin_ctz(radix));
+    }
+
+    // Limb k of the number in bytes[0..size), bytes past the end counting as zero
+    limb_t loadLimb(const unsigned char *bytes, size_t size, size_t k, bool bigEndian) {
+        size_t low = 8 * k;
+        limb_t limb = 0;
+        if (size - low >= 8) {
+            std::memcpy(&limb, bigEndian ? bytes + size - low - 8 : bytes + low, 8);
+            return bigEndian == LITTLE_ENDIAN_HOST ? __builtin_bswap64(limb) : limb;
+        }
+        for (size_t i = low; i < size; ++i) {
+            limb |= static_cast<limb_t>(bytes[bigEndian ? size - 1 - i : i]) << (8 * (i - low));
+        }
+        return limb;
+    }
+
+    // Stores limb as limb k of the number in bytes[0..size), dropping what lies past the end
+    void storeLimb(unsigned char *bytes, size_t size, size_t k, bool bigEndian, limb_t limb) {
+        size_t low = 8 * k;
+        if (size - low >= 8) {
+            if (bigEndian == LITTLE_ENDIAN_HOST) limb = __builtin_bswap64(limb);
+            std::memcpy(bigEndian ? bytes + size - low - 8 : bytes + low, &limb, 8);
+            return;
+        }
+        for (size_t i = low; i < size; ++i, limb >>= 8) {
+            bytes[bigEndian ? size - 1 - i : i] = static_cast<unsigned char>(limb);
+        }
+    }
+}
+
+BigInteger BigInteger::operator+(const BigInteger &h) const & {
     BigInteger rtn(*this);
     rtn += h;
     return rtn;
 }
 
-BigInteger BigInteger::operator-(const BigInteger &h) const {
+BigInteger BigInteger::operator+(const BigInteger &h) && {
+    *this += h;
+    return std::move(*this);
+}
+
+BigInteger BigInteger::operator+(BigInteger &&h) const & {
+    h += *this;
+    return std::move(h);
+}
+
+BigInteger BigInteger::operator+(BigInteger &&h) && {
+    *this += h;
+    return std::move(*this);
+}
+
+BigInteger BigInteger::operator-(const BigInteger &h) const & {
     BigInteger rtn(*this);
     rtn -= h;
     return rtn;
 }
 
-BigInteger BigInteger::operator*(const BigInteger &h) const {
+BigInteger BigInteger::operator-(const BigInteger &h) && {
+    *this -= h;
+    return std::move(*this);
+}
+
+BigInteger BigInteger::operator-(BigInteger &&h) const & {
+    // a - h = -(h - a)
+    h -= *this;
+    h.negative = !h.negative && !h.data.empty();
+    return std::move(h);
+}
+
+BigInteger BigInteger::operator-(BigInteger &&h) && {
+    *this -= h;
+    return std::move(*this);
+}
+
+BigInteger BigInteger::operator*(const BigInteger &h) const & {
     BigInteger rtn(*this);
     rtn *= h;
     return rtn;
 }
 
-BigInteger BigInteger::operator/(const BigInteger &h) const {
+BigInteger BigInteger::operator*(const BigInteger &h) && {
+    *this *= h;
+    return std::move(*this);
+}
+
+BigInteger BigInteger::operator/(const BigInteger &h) const & {
     BigInteger rtn(*this);
     rtn /= h;
     return rtn;
 }
 
-BigInteger BigInteger::operator%(const BigInteger &h) const {
+BigInteger BigInteger::operator/(const BigInteger &h) && {
+    *this /= h;
+    return std::move(*this);
+}
+
+BigInteger BigInteger::operator%(const BigInteger &h) const & {
     BigInteger rtn(*this);
     rtn %= h;
     return rtn;
 }
 
+BigInteger BigInteger::operator%(const BigInteger &h) && {
+    *this %= h;
+    return std::move(*this);
+}
+
 BigInteger BigInteger::operator<<(const BigInteger &h) const {
     BigInteger rtn(*this);
     rtn <<= h;
@@ -45,134 +139,286 @@ BigInteger BigInteger::operator>>(const BigInteger &h) const {
     return rtn;
 }
 
+BigInteger BigInteger::operator<<(size_t h) const {
+    BigInteger rtn(*this);
+    rtn <<= h;
+    return rtn;
+}
+
+BigInteger BigInteger::operator>>(size_t h) const {
+    BigInteger rtn(*this);
+    rtn >>= h;
+    return rtn;
+}
+
 
 BigInteger &BigInteger::operator+=(const BigInteger &h) {
-    if (negative == h.negative) {
-        selfPlus(h);
-    } else {
-        if (compareAbsolute(*this, h) >= 0) {
-            selfMinus(h);
-        } else {
-            BigInteger temp = h;
-            temp.selfMinus(*this);
-            *this = temp;
-        }
+    ScopedOperation scope(Operation::Add, std::max(data.size(), h.data.size()));
+    if (&h == this) {
+        // x + x, doubled in place here rather than by <<= so that only the Add is counted
+        size_t n = data.size();
+        if (n == 0) return *this;
+        data.resize(n + 1);
+        data[n] = limbs::lshift(data.data(), data.data(), n, 1);
+        if (data.back() == 0) data.pop_back();
+        return *this;
     }
+    addSigned(h.data.data(), h.data.size(), h.negative);
     return *this;
 }
 
-void BigInteger::selfPlus(const BigInteger &h) {
-    char carry = 0;
-    size_t n = std::max(data.size(), h.data.size());
-    std::vector<char> result;
-
-    for (size_t i = 0; i < n; i++) {
-        char aValue = i < data.size() ? data[i] : (char) 0;
-        char bValue = i < h.data.size() ? h.data[i] : (char) 0;
-
-        char sum = aValue + bValue + carry;
-        carry = sum / 10;
-        result.push_back(sum % (char) 10);
+BigInteger &BigInteger::operator-=(const BigInteger &h) {
+    ScopedOperation scope(Operation::Subtract, std::max(data.size(), h.data.size()));
+    if (&h == this) {
+        data.clear();
+        negative = false;
+        return *this;
     }
+    addSigned(h.data.data(), h.data.size(), !h.negative);
+    return *this;
+}
 
-    if (carry > 0) {
-        result.push_back(carry);
+void BigInteger::addSigned(const limb_t *b, size_t bn, bool bNegative) {
+    if (bn == 0) return;
+    if (data.empty()) negative = bNegative;
+    size_t n = data.size();
+    if (negative == bNegative) {
+        selfPlus(b, bn);
+    } else if (n > bn || (n == bn && limbs::cmp(data.data(), b, n) >= 0)) {
+        selfMinus(b, bn);
+    } else {
+        // The current magnitude is smaller: subtract the other way round and take b's sign
+        selfMinusFrom(b, bn);
+        negative = bNegative;
     }
-    data = std::move(result);
 }
 
-
-BigInteger &BigInteger::operator-=(const BigInteger &h) {
-    // If the operands have different signs, delegate to addition.
-    if (negative != h.negative) {
-        negative = !negative;
-        selfPlus(h);
+void BigInteger::selfPlus(const limb_t *b, size_t bn) {
+    size_t n = data.size();
+    size_t resultSize = std::max(n, bn);
+    data.resize(resultSize + 1);
+    limb_t *r = data.data();
+    limb_t carry = n >= bn ? limbs::add(r, r, n, b, bn) : limbs::add(r, b, bn, r, n);
+    if (carry) r[resultSize] = carry;
+    else data.pop_back();
+}
+
+void BigInteger::selfMinus(const limb_t *b, size_t bn) {
+    limbs::sub(data.data(), data.data(), data.size(), b, bn);
+    normalize();
+}
+
+void BigInteger::selfMinusFrom(const limb_t *b, size_t bn) {
+    size_t n = data.size();
+    data.resize(bn);
+    limbs::sub(data.data(), b, bn, data.data(), n);
+    normalize();
+}
+
+void BigInteger::addProduct(const BigInteger &a, const BigInteger &b, bool productNegative) {
+    if (a.data.empty() || b.data.empty()) return;
+    const BigInteger &longer = a.data.size() >= b.data.size() ? a : b;
+    const BigInteger &shorter = &longer == &a ? b : a;
+    size_t ln = longer.data.size(), sn = shorter.data.size();
+
+    // A one-limb factor with a matching sign accumulates straight into our limbs
+    if (sn == 1 && (data.empty() || negative == productNegative)) {
+        limb_t factor = shorter.data[0];
+        size_t n = data.size();
+        data.resize(std::max(n, ln) + 1);
+        if (n == 0) negative = productNegative;
+        // longer may be *this; its low ln limbs are unchanged by the resize
+        limb_t *r = data.data();
+        limb_t carry = limbs::addmul_1(r, &longer == this ? r : longer.data.data(), ln, factor);
+        limbs::add_1(r + ln, r + ln, data.size() - ln, carry);
+        normalize();
+        return;
     }
 
-    // If the current number is smaller than the given number, swap them and negate the result.
-    if (compareAbsolute(*this, h) < 0) {
-        BigInteger temp = h;
-        temp -= *this;
-        *this = temp;
-        negative = !negative;
-    } else selfMinus(h);
-
-    return *this;
-}
+    // Otherwise the product goes through the scratch pool
+    limbs::scratch_vector product(ln + sn, limbs::scratch_resource());
+    if (sn == 1) {
+        product[ln] = limbs::mul_1(product.data(), longer.data.data(), ln, shorter.data[0]);
+    } else if (&longer == &shorter) {
+        limbs::sqr(product.data(), longer.data.data(), ln);
+    } else {
+        limbs::mul(product.data(), longer.data.data(), ln, shorter.data.data(), sn);
+    }
+    addSigned(product.data(), limbs::normalized_size(product.data(), ln + sn), productNegative);
+}
+
+BigInteger &addmul(BigInteger &acc, const BigInteger &a, const BigInteger &b) {
+    acc.addProduct(a, b, a.negative != b.negative);
+    return acc;
+}
+
+BigInteger &submul(BigInteger &acc, const BigInteger &a, const BigInteger &b) {
+    acc.addProduct(a, b, a.negative == b.negative);
+    return acc;
+}
+
+BigInteger pow(const BigInteger &base, uint64_t exponent) {
+    if (exponent == 0) return BigInteger::ONE();
+    BigInteger result;
+    if (base.data.empty()) return result;
+
+    // base = odd 2^zeros, so base^exponent = odd^exponent 2^(zeros exponent)
+    const limb_t *b = base.data.data();
+    size_t zeroLimbs = 0;
+    while (b[zeroLimbs] == 0) ++zeroLimbs;
+    unsigned zeroBits = __builtin_ctzll(b[zeroLimbs]);
+    size_t zeros = zeroLimbs * limbs::LIMB_BITS + zeroBits, shift, oddBits;
+    if (__builtin_mul_overflow(zeros, exponent, &shift)) throw std::runtime_error("Power too large");
+    limbs::scratch_vector odd(b + zeroLimbs, b + base.data.size(), limbs::scratch_resource());
+    if (zeroBits) limbs::rshift(odd.data(), odd.data(), odd.size(), zeroBits);
+    size_t on = limbs::normalized_size(odd.data(), odd.size());
+
+    // A power of more than 2^50 bits, the 128 TiB of a 48-bit address space,
+    // is refused before anything is allocated
+    constexpr size_t maxBits = size_t(1) << 50;
+    result.negative = base.negative && (exponent & 1);
+
+    // ±2^zeros: the power is a single shift
+    if (on == 1 && odd[0] == 1) {
+        if (shift >= maxBits) throw std::runtime_error("Power too large");
+        result.data.push_back(1);
+        result <<= shift;
+        return result;
+    }
+    if (__builtin_mul_overflow(base.bitLength() - zeros, exponent, &oddBits) ||
+        shift > maxBits || oddBits > maxBits - shift) {
+        throw std::runtime_error("Power too large");
+    }
 
-void BigInteger::selfMinus(const BigInteger &h) {
-    int carry = 0;
-    for (size_t i = 0; i < h.data.size() || carry; ++i) {
-        if (i < h.data.size()) {
-            data[i] -= h.data[i] + carry;
-        } else {
-            data[i] -= carry;
-        }
-        if (data[i] < 0) {
-            carry = 1;
-            data[i] += 10;
+    // Left to right: square, then multiply by the base when the bit is set.
+    // A window of precomputed powers saves nothing here, as multiplying by
+    // the base itself is already the cheapest step.
+    // The products are written at full width, which can take one limb more
+    // than the final value needs
+    size_t capacity = oddBits / limbs::LIMB_BITS + 2, n = on;
+    limbs::scratch_vector power(odd.begin(), odd.begin() + on, limbs::scratch_resource()), next(limbs::scratch_resource());
+    power.resize(capacity);
+    next.resize(capacity);
+    for (int bit = 62 - __builtin_clzll(exponent); bit >= 0; --bit) {
+        limbs::sqr(next.data(), power.data(), n);
+        n = limbs::normalized_size(next.data(), 2 * n);
+        if ((exponent >> bit) & 1) {
+            if (on == 1) {
+                limb_t carry = limbs::mul_1(next.data(), next.data(), n, odd[0]);
+                if (carry) next[n++] = carry;
+                power.swap(next);
+            } else {
+                limbs::mul(power.data(), next.data(), n, odd.data(), on);
+                n = limbs::normalized_size(power.data(), n + on);
+            }
         } else {
-            carry = 0;
+            power.swap(next);
         }
     }
 
-    // Remove leading zeros.
-    while (data.size() > 1 && data.back() == 0) {
-        data.pop_back();
-    }
+    result.data.assign(power.data(), power.data() + n);
+    result <<= shift;
+    return result;
+}
 
-    // Check for zero.
-    if (data.size() == 1 && data[0] == 0) {
-        negative = false;
-    }
+void BigInteger::normalize() {
+    data.resize(limbs::normalized_size(data.data(), data.size()));
+    if (data.empty()) negative = false;
 }
 
 BigInteger &BigInteger::operator*=(const BigInteger &h) {
-    negative = negative ^ h.negative;
-    std::vector<char> res(data.size() + h.data.size());
-    std::fill(res.begin(), res.end(), 0);
-
-    for (int i = 0; i < data.size(); i++) {
-        for (int j = 0; j < h.data.size(); j++) {
-            res[i + j] += data[i] * h.data[j];
-            res[i + j + 1] += res[i + j] / 10;
-            res[i + j] %= 10;
-        }
-    }
-
-    while (res.size() > 1 && res.back() == 0) {
-        res.pop_back();
+    ScopedOperation scope(Operation::Multiply, std::max(data.size(), h.data.size()));
+    if (data.empty() || h.data.empty()) {
+        data.clear();
+        negative = false;
+        return *this;
     }
-
+    negative = negative ^ h.negative;
+    LimbVector res(data.resource());
+    multiplyLimbs(res, data.data(), data.size(), h.data.data(), h.data.size());
     data = std::move(res);
+    normalize();
     return *this;
 }
 
 BigInteger &BigInteger::operator/=(const BigInteger &h) {
-    BigInteger quotient = ZERO(), remainder = ZERO();
-    divideAndRemainder(h, quotient, remainder);
-    *this = quotient;
+    ScopedOperation scope(Operation::Divide, data.size());
+    BigInteger remainder;
+    divideAndRemainder(h, *this, remainder);
     return *this;
 }
 
 BigInteger &BigInteger::operator%=(const BigInteger &h) {
-    BigInteger quotient = ZERO(), remainder = ZERO();
-    divideAndRemainder(h, quotient, remainder);
-    *this = remainder;
+    ScopedOperation scope(Operation::Modulo, data.size());
+    BigInteger quotient;
+    divideAndRemainder(h, quotient, *this);
     return *this;
 }
 
+std::pair<BigInteger, BigInteger> BigInteger::divmod(const BigInteger &h) const {
+    ScopedOperation scope(Operation::Divide, data.size());
+    std::pair<BigInteger, BigInteger> rtn;
+    divideAndRemainder(h, rtn.first, rtn.second);
+    return rtn;
+}
+
 BigInteger &BigInteger::operator<<=(const BigInteger &h) {
-    for (BigInteger i = ZERO(); i < h; ++i) {
-        (*this) *= TWO();
+    if (h.negative) throw std::runtime_error("Negative shift count");
+    if (h.data.size() > 1) throw std::runtime_error("Shift count too large");
+    return *this <<= static_cast<size_t>(h.data.empty() ? 0 : h.data[0]);
+}
+
+BigInteger &BigInteger::operator>>=(const BigInteger &h) {
+    if (h.negative) throw std::runtime_error("Negative shift count");
+    // Any count past one limb shifts every bit out
+    if (h.data.size() > 1) return *this >>= std::numeric_limits<size_t>::max();
+    return *this >>= static_cast<size_t>(h.data.empty() ? 0 : h.data[0]);
+}
+
+BigInteger &BigInteger::operator<<=(size_t h) {
+    ScopedOperation scope(Operation::ShiftLeft, data.size());
+    if (data.empty() || h == 0) return *this;
+    size_t limbShift = h / limbs::LIMB_BITS, n = data.size();
+    unsigned bitShift = h % limbs::LIMB_BITS;
+    data.resize(n + limbShift + 1);
+    limb_t *r = data.data();
+    if (bitShift) {
+        r[n + limbShift] = limbs::lshift(r + limbShift, r, n, bitShift);
+    } else {
+        std::move_backward(r, r + n, r + n + limbShift);
     }
+    std::fill(r, r + limbShift, 0);
+    if (data.back() == 0) data.pop_back();
     return *this;
 }
 
-BigInteger &BigInteger::operator>>=(const BigInteger &h) {
-    for (BigInteger i = ZERO(); i < h; ++i) {
-        (*this) /= TWO();
+BigInteger &BigInteger::operator>>=(size_t h) {
+    ScopedOperation scope(Operation::ShiftRight, data.size());
+    if (data.empty() || h == 0) return *this;
+    size_t limbShift = h / limbs::LIMB_BITS;
+    unsigned bitShift = h % limbs::LIMB_BITS;
+    // Flooring a negative value means rounding its magnitude up whenever a set bit falls off
+    bool roundUp = false;
+    if (negative) {
+        size_t dropped = std::min(limbShift, data.size());
+        roundUp = limbs::normalized_size(data.data(), dropped) > 0;
+        if (!roundUp && limbShift < data.size() && bitShift) {
+            roundUp = (data[limbShift] << (limbs::LIMB_BITS - bitShift)) != 0;
+        }
+    }
+    if (limbShift >= data.size()) {
+        data.clear();
+    } else {
+        size_t n = data.size() - limbShift;
+        if (bitShift) limbs::rshift(data.data(), data.data() + limbShift, n, bitShift);
+        else std::move(data.begin() + limbShift, data.end(), data.begin());
+        data.resize(limbs::normalized_size(data.data(), n));
+    }
+    if (roundUp) {
+        limb_t carry = limbs::add_1(data.data(), data.data(), data.size(), 1);
+        if (carry) data.push_back(carry);
     }
+    if (data.empty()) negative = false;
     return *this;
 }
 
@@ -242,68 +488,247 @@ BigInteger BigInteger::operator--(int) {
 
 
 char BigInteger::compareAbsolute(const BigInteger &num1, const BigInteger &num2) {
+    ScopedOperation scope(Operation::Compare, std::max(num1.data.size(), num2.data.size()));
     if (num1.data.size() > num2.data.size()) return 1;
     if (num1.data.size() < num2.data.size()) return -1;
+    return static_cast<char>(limbs::cmp(num1.data.data(), num2.data.data(), num1.data.size()));
+}
+
+std::string BigInteger::toString() const {
+    return toString(10);
+}
 
-    for (size_t i = num1.data.size() - 1;; --i) {
-        if (num1.data[i] > num2.data[i]) return 1;
-        if (num1.data[i] < num2.data[i]) return -1;
-        if (i == 0) return 0;
+std::string BigInteger::toString(unsigned radix) const {
+    unsigned bits = radixBits(radix);
+    if (radix != 10 && bits == 0) throw std::runtime_error("Unsupported radix");
+    std::string rtn(radix == 10 ? decimalSizeUpperBound() : 1 + negative + bitLength() / bits, '\0');
+    rtn.resize(toChars(rtn.data(), rtn.data() + rtn.size(), radix).ptr - rtn.data());
+    return rtn;
+}
+
+size_t BigInteger::decimalSizeUpperBound() const {
+    if (data.empty()) return 1;
+    return (negative ? 1 : 0) + limbs::decimal_size_bound(data.size());
+}
+
+std::to_chars_result BigInteger::toChars(char *first, char *last, unsigned radix) const {
+    unsigned bits = radixBits(radix);
+    if (radix != 10 && bits == 0) throw std::runtime_error("Unsupported radix");
+    ScopedOperation scope(Operation::ToString, data.size());
+    auto room = static_cast<size_t>(last - first);
+    size_t sign = negative ? 1 : 0;
+    if (data.empty()) {
+        if (room == 0) return {last, std::errc::value_too_large};
+        *first = radix == 64 ? 'A' : '0';
+        return {first + 1, std::errc()};
+    }
+    if (radix != 10) {
+        if (room < sign + (bitLength() + bits - 1) / bits) return {last, std::errc::value_too_large};
+        if (negative) *first++ = '-';
+        return {limbs::to_radix_pow2(first, data.data(), data.size(), bits), std::errc()};
+    }
+    if (room < decimalSizeUpperBound()) {
+        // The digits may fit all the same, which takes converting them aside
+        std::string digits = limbs::to_decimal(data.data(), data.size());
+        if (room < sign + digits.size()) return {last, std::errc::value_too_large};
+        if (negative) *first++ = '-';
+        return {std::copy(digits.begin(), digits.end(), first), std::errc()};
+    }
+    if (negative) *first++ = '-';
+    return {limbs::to_decimal(first, data.data(), data.size()), std::errc()};
+}
+
+BigInteger BigInteger::fromString(const std::string &text, unsigned radix) {
+    unsigned bits = radixBits(radix);
+    if (radix != 10 && bits == 0) throw std::runtime_error("Unsupported radix");
+    bool isNegative = !text.empty() && text[0] == '-';
+    const char *first = text.data() + (isNegative ? 1 : 0), *last = text.data() + text.size();
+    if (first == last) throw std::runtime_error("Invalid integer");
+    BigInteger result;
+    if (radix == 10) {
+        result.parseDecimal(first, last);
+    } else {
+        auto length = static_cast<size_t>(last - first);
+        ScopedOperation scope(Operation::Parse, length * bits / limbs::LIMB_BITS + 1);
+        for (const char *it = first; it != last; ++it) {
+            if (limbs::radix_digit(*it, bits) < 0) throw std::runtime_error("Invalid integer");
+        }
+        result.data.resize((length * bits + limbs::LIMB_BITS - 1) / limbs::LIMB_BITS);
+        limbs::from_radix_pow2(result.data.data(), first, last, bits);
+        result.normalize();
+    }
+    result.negative = isNegative && !result.data.empty();
+    return result;
+}
+
+BigInteger BigInteger::fromBytes(const void *bytes, size_t size, ByteOrder order, bool isSigned) {
+    const auto *in = static_cast<const unsigned char *>(bytes);
+    bool bigEndian = order == ByteOrder::BigEndian;
+    BigInteger result;
+    if (size == 0) return result;
+    size_t n = (size + 7) / 8;
+    result.data.resize(n);
+    limb_t *r = result.data.data();
+    for (size_t k = 0; k < n; ++k) r[k] = loadLimb(in, size, k, bigEndian);
+    if (isSigned && ((bigEndian ? in[0] : in[size - 1]) & 0x80) != 0) {
+        // Sign-extend to whole limbs and negate, leaving the magnitude
+        if (size % 8 != 0) r[n - 1] |= ~limb_t(0) << (8 * (size % 8));
+        for (size_t k = 0; k < n; ++k) r[k] = ~r[k];
+        limbs::add_1(r, r, n, 1);
+        result.negative = true;
+    }
+    result.normalize();
+    return result;
+}
+
+size_t BigInteger::byteLength(bool isSigned) const {
+    if (data.empty()) return 0;
+    size_t bits = bitLength();
+    if (!isSigned) return (bits + 7) / 8;
+    // -2^k fits in k + 1 bits, as do the positive values below 2^k
+    bool powerOfTwo = (data.back() & (data.back() - 1)) == 0 &&
+                      limbs::normalized_size(data.data(), data.size() - 1) == 0;
+    if (negative && powerOfTwo) --bits;
+    return bits / 8 + 1;
+}
+
+void BigInteger::toBytes(void *buffer, size_t size, ByteOrder order, bool isSigned) const {
+    if (negative && !isSigned) throw std::runtime_error("Negative integer as unsigned bytes");
+    if (byteLength(isSigned) > size) throw std::runtime_error("Integer does not fit in the buffer");
+    auto *out = static_cast<unsigned char *>(buffer);
+    bool bigEndian = order == ByteOrder::BigEndian;
+    // Two's complement of -m is ~(m - 1), taken limb by limb
+    limb_t borrow = negative ? 1 : 0;
+    for (size_t k = 0; 8 * k < size; ++k) {
+        limb_t limb = k < data.size() ? data[k] : 0;
+        if (negative) {
+            limb_t decremented = limb - borrow;
+            borrow = limb < borrow;
+            limb = ~decremented;
+        }
+        storeLimb(out, size, k, bigEndian, limb);
     }
 }
 
-std::string BigInteger::toString() const {
-    std::string rtn;
-    if (negative) rtn = "-";
-    for (auto it = data.rbegin(); it < data.rend(); ++it) {
-        rtn += ('0' + *it);
+void BigInteger::parseDecimal(const char *first, const char *last) {
+    ScopedOperation scope(Operation::Parse, static_cast<size_t>(last - first) / 19 + 1);
+    for (const char *it = first; it != last; ++it) {
+        if (*it > '9' || *it < '0') throw std::runtime_error("Invalid integer");
     }
-    return rtn;
+    std::vector<limb_t> parsed = limbs::from_decimal(first, last);
+    data.assign(parsed.data(), parsed.data() + parsed.size());
+    normalize();
 }
 
 void BigInteger::divideAndRemainder(const BigInteger &divisor, BigInteger &quotient, BigInteger &remainder) const {
-    if (divisor == ZERO()) {
+    divideLimbs(data.data(), data.size(), negative, divisor.data.data(), divisor.data.size(), divisor.negative,
+                quotient, remainder);
+}
+
+void BigInteger::multiplyLimbs(LimbVector &r, const limb_t *a, size_t an, const limb_t *b, size_t bn) {
+    r.resize(an + bn);
+    if (a == b && an == bn) {
+        limbs::sqr(r.data(), a, an);
+    } else if (an >= bn) {
+        limbs::mul(r.data(), a, an, b, bn);
+    } else {
+        limbs::mul(r.data(), b, bn, a, an);
+    }
+}
+
+void BigInteger::divideLimbs(const limb_t *a, size_t n, bool aNegative, const limb_t *d, size_t dn,
+                             bool dNegative, BigInteger &quotient, BigInteger &remainder) {
+    if (dn == 0) {
         throw std::runtime_error("Division by zero");
     }
-    if (*this == ZERO()) {
-        quotient = ZERO();
-        remainder = ZERO();
+    bool quotientNegative = aNegative != dNegative, remainderNegative = aNegative;
+    if (n < dn || (n == dn && limbs::cmp(a, d, n) < 0)) {
+        remainder.data.assign(a, a + n);
+        remainder.negative = remainderNegative;
+        quotient.data.clear();
+        quotient.negative = false;
         return;
     }
 
-    BigInteger dividend = *this;
-    dividend.negative = false;
-    BigInteger tmpDivisor = divisor;
-    tmpDivisor.negative = false;
+    // Any of the operands may alias the outputs, so work in fresh buffers
+    LimbVector q(quotient.data.resource()), r(remainder.data.resource());
+    q.resize(n - dn + 1);
+    r.resize(dn);
+    limbs::divrem(q.data(), r.data(), a, n, d, dn);
 
-    quotient = ZERO();
-    remainder = dividend;
+    quotient.data = std::move(q);
+    quotient.negative = quotientNegative;
+    quotient.normalize();
+    remainder.data = std::move(r);
+    remainder.negative = remainderNegative;
+    remainder.normalize();
+}
 
-    while (remainder >= tmpDivisor) {
-        BigInteger currentDivisor = tmpDivisor;
-        BigInteger currentQuotient(1);
+char BigInteger::at(size_t index) const {
+    std::string digits = toString();
+    if (index >= digits.size() - negative) throw std::out_of_range("Digit index out of range");
+    return static_cast<char>(digits[index + negative] - '0');
+}
 
-        while ((currentDivisor * TWO()) <= remainder) {
-            currentDivisor *= TWO();
-            currentQuotient *= TWO();
-        }
+BigInteger::DigitReference BigInteger::operator[](size_t index) {
+    return {*this, index};
+}
 
-        remainder -= currentDivisor;
-        quotient += currentQuotient;
+BigInteger::DigitReference &BigInteger::DigitReference::operator=(char digit) {
+    if (digit > 9 || digit < 0) throw std::runtime_error("Invalid integer");
+    // One conversion gives both the old digit and its position from the right
+    std::string digits = owner.toString();
+    size_t length = digits.size() - owner.negative;
+    if (index >= length) throw std::out_of_range("Digit index out of range");
+    int delta = digit - (digits[index + owner.negative] - '0');
+    if (delta != 0) {
+        // Writing a digit moves the magnitude by delta * 10^position
+        owner += powerOfTen(length - 1 - index) * BigInteger(owner.negative ? -delta : delta);
     }
+    return *this;
+}
 
-    quotient.negative = (this->negative != divisor.negative);
-    remainder.negative = this->negative;
+BigInteger BigInteger::powerOfTen(size_t exponent) {
+    std::vector<limb_t> power = limbs::power_of_ten(exponent);
+    BigInteger result;
+    result.data.assign(power.data(), power.data() + power.size());
+    return result;
 }
 
-char BigInteger::at(size_t index) const {
-    return data[data.size() - 1 - index];
+size_t BigInteger::size() const {
+    if (data.size() <= 1) return std::to_string(data.empty() ? 0 : data[0]).size();
+    size_t n = data.size();
+    // log10 |x| from the top two limbs, off by well under 1e-6 below 2^32
+    // bits, settles the count unless it lands next to an integer
+    if (n < (size_t(1) << 26)) {
+        double top = std::ldexp(static_cast<double>(data[n - 1]), limbs::LIMB_BITS) + static_cast<double>(data[n - 2]);
+        double log = std::log10(top) + static_cast<double>((n - 2) * limbs::LIMB_BITS) * 0.30102999566398120;
+        double whole = std::floor(log);
+        if (log - whole > 1e-6 && whole + 1 - log > 1e-6) return static_cast<size_t>(whole) + 1;
+    }
+    // 2^(bits-1) <= |x| < 2^bits leaves only two candidates for the digit count
+    auto guess = static_cast<size_t>(static_cast<double>(bitLength() - 1) * 0.30102999566398120);
+    BigInteger threshold = powerOfTen(guess + 1);
+    return compareAbsolute(*this, threshold) >= 0 ? guess + 2 : guess + 1;
 }
 
-char &BigInteger::operator[](size_t index) {
-    return data[data.size() - 1 - index];
+size_t BigInteger::bitLength() const {
+    if (data.empty()) return 0;
+    return data.size() * limbs::LIMB_BITS - __builtin_clzll(data.back());
 }
 
-size_t BigInteger::size() const {
-    return data.size();
+void BigInteger::setParallelism(size_t threads, size_t minimumLimbs) {
+    limbs::set_parallelism(threads, minimumLimbs);
+}
+
+std::optional<long long> BigInteger::toLongLong() const {
+    if (data.empty()) return 0;
+    if (data.size() > 1) return {};
+    limb_t magnitude = data[0];
+    if (negative) {
+        if (magnitude > static_cast<limb_t>(std::numeric_limits<long long>::max()) + 1) return {};
+        return static_cast<long long>(0 - magnitude);
+    }
+    if (magnitude > static_cast<limb_t>(std::numeric_limits<long long>::max())) return {};
+    return static_cast<long long>(magnitude);
 }
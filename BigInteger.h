@@ -2,14 +2,22 @@
 // Created by Joe Yu on 4/24/23.
 //
 #include <vector>
+#include <cstdint>
 #include <type_traits>
 #include <string>
 #include <algorithm>
 #include <stdexcept>
+#include <utility>
+#include <optional>
+#include <charconv>
+#include <iosfwd>
+#include "LimbVector.h"
 
 #ifndef BIGINTEGER_BIGINTEGER_H
 #define BIGINTEGER_BIGINTEGER_H
 
+class BigIntegerView;
+
 class BigInteger {
 public:
     static BigInteger ZERO() {
@@ -28,54 +36,62 @@ public:
     }
 
     template<typename T, typename std::enable_if<std::is_integral<T>::value>::type * = nullptr>
-    BigInteger(T x) {
-        if (x < 0) {
-            x = -x;
-            negative = true;
-        } else negative = false;
-        while (x > 0) {
-            data.push_back((char) (x % 10));
-            x /= 10;
+    BigInteger(T x) : negative(x < 0) {
+        using U = typename std::conditional<std::is_same<T, bool>::value,
+                std::common_type<unsigned>, std::make_unsigned<T>>::type::type;
+        U magnitude = negative ? static_cast<U>(U(0) - static_cast<U>(x)) : static_cast<U>(x);
+        while (magnitude > 0) {
+            data.push_back(static_cast<uint64_t>(magnitude));
+            if constexpr (sizeof(U) > sizeof(uint64_t)) magnitude >>= 64;
+            else magnitude = 0;
         }
-        if (data.empty()) data.push_back(0);
     }
 
+    // Constructor for decimal digits stored least significant first
     template<typename T, typename std::enable_if<std::is_integral<T>::value>::type * = nullptr>
-    BigInteger(const std::vector<T> &input_vector, bool negative=false) : negative(negative){
-        for (const T &value: input_vector) {
-            if (value > 9 || value < 0) throw std::runtime_error("Invalid integer");
-            data.push_back(static_cast<char>(value));
+    BigInteger(const std::vector<T> &input_vector, bool negative=false) : negative(false) {
+        std::string digits;
+        digits.reserve(input_vector.size());
+        for (auto it = input_vector.rbegin(); it != input_vector.rend(); ++it) {
+            if (*it > 9 || *it < 0) throw std::runtime_error("Invalid integer");
+            digits.push_back(static_cast<char>('0' + *it));
         }
+        parseDecimal(digits.data(), digits.data() + digits.size());
+        this->negative = negative && !data.empty();
     }
 
     // Constructor for std::string containing numbers
-    BigInteger(std::string number_string) {
-        if (number_string.empty()) {
-            data.push_back(0);
-            negative = false;
-            return;
-        }
-        if (number_string[0] == '-') {
-            negative = true;
-            number_string = number_string.substr(1);
-            if (number_string.empty()) {
-                throw std::runtime_error("Invalid integer");
-            } else if (number_string[0] == '0') {
-                data.push_back(0);
-                negative = false;
-                return;
-            }
-        } else negative = false;
-        for (const char &c: number_string) {
-            // Subtract '0' from each character and push the result into the char_vector
-            if (c > '9' || c < '0') throw std::runtime_error("Invalid integer");
-            data.push_back(c - '0');
-        }
-        std::reverse(data.begin(), data.end());
+    BigInteger(const std::string &number_string) : negative(false) {
+        if (number_string.empty()) return;
+        bool isNegative = number_string[0] == '-';
+        const char *first = number_string.data() + (isNegative ? 1 : 0);
+        if (first == number_string.data() + number_string.size()) throw std::runtime_error("Invalid integer");
+        parseDecimal(first, number_string.data() + number_string.size());
+        negative = isNegative && !data.empty();
     }
 
     BigInteger(): BigInteger(0) {}
 
+    // Zero, with its limbs to come from resource
+    explicit BigInteger(std::pmr::memory_resource *resource) : negative(false), data(resource) {}
+
+    BigInteger(const BigInteger &other, std::pmr::memory_resource *resource)
+            : negative(other.negative), data(other.data, resource) {}
+
+    // While one is alive, BigIntegers created on this thread (copies and
+    // operator results included) take their limbs from its resource, e.g. a
+    // std::pmr::monotonic_buffer_resource released after each request
+    using ResourceScope = LimbVector::ResourceScope;
+
+    [[nodiscard]] std::pmr::memory_resource *memoryResource() const { return data.resource(); }
+
+    // Opt-in multithreading: products of operands averaging at least
+    // minimumLimbs limbs, and the divisions and conversions built on them,
+    // fan out over a pool of threads threads, the calling one included.
+    // threads <= 1, the default, keeps everything on the calling thread.
+    // Must not be called while BigInteger arithmetic runs on other threads.
+    static void setParallelism(size_t threads, size_t minimumLimbs = 2048);
+
     BigInteger &operator++();
 
     BigInteger &operator--();
@@ -97,20 +113,43 @@ public:
     bool operator!=(const BigInteger &h) const;
 
 
-    BigInteger operator+(const BigInteger &h) const;
+    // The rvalue overloads compute into the dying operand's storage instead of a copy
+    BigInteger operator+(const BigInteger &h) const &;
+
+    BigInteger operator+(const BigInteger &h) &&;
+
+    BigInteger operator+(BigInteger &&h) const &;
+
+    BigInteger operator+(BigInteger &&h) &&;
+
+    BigInteger operator-(const BigInteger &h) const &;
+
+    BigInteger operator-(const BigInteger &h) &&;
+
+    BigInteger operator-(BigInteger &&h) const &;
 
-    BigInteger operator-(const BigInteger &h) const;
+    BigInteger operator-(BigInteger &&h) &&;
 
-    BigInteger operator*(const BigInteger &h) const;
+    BigInteger operator*(const BigInteger &h) const &;
 
-    BigInteger operator/(const BigInteger &h) const;
+    BigInteger operator*(const BigInteger &h) &&;
 
-    BigInteger operator%(const BigInteger &h) const;
+    BigInteger operator/(const BigInteger &h) const &;
+
+    BigInteger operator/(const BigInteger &h) &&;
+
+    BigInteger operator%(const BigInteger &h) const &;
+
+    BigInteger operator%(const BigInteger &h) &&;
 
     BigInteger operator<<(const BigInteger &h) const;
 
     BigInteger operator>>(const BigInteger &h) const;
 
+    BigInteger operator<<(size_t h) const;
+
+    BigInteger operator>>(size_t h) const;
+
     BigInteger &operator+=(const BigInteger &h);
 
     BigInteger &operator-=(const BigInteger &h);
@@ -125,28 +164,159 @@ public:
 
     BigInteger &operator>>=(const BigInteger &h);
 
+    // Multiplies by 2^h
+    BigInteger &operator<<=(size_t h);
+
+    // Divides by 2^h rounding toward negative infinity, like >> on a two's complement value
+    BigInteger &operator>>=(size_t h);
+
+    // acc += a * b and acc -= a * b without a temporary for the product. Any
+    // of the three may be the same object.
+    friend BigInteger &addmul(BigInteger &acc, const BigInteger &a, const BigInteger &b);
+
+    friend BigInteger &submul(BigInteger &acc, const BigInteger &a, const BigInteger &b);
+
+    // base^exponent, with 0^0 = 1. Powers of two in the base become a shift and
+    // the rest is squared up bit by bit with the dedicated squaring kernels.
+    // Throws for a power of more than 2^50 bits.
+    friend BigInteger pow(const BigInteger &base, uint64_t exponent);
+
+    // Quotient and remainder of one division, truncating like operator/ and operator%
+    [[nodiscard]] std::pair<BigInteger, BigInteger> divmod(const BigInteger &h) const;
+
+
+    // Writable view of one decimal digit, as returned by operator[]. It
+    // reads, assigns and takes += and -=; a result outside 0-9 throws.
+    // Other compound assignments and ++ and -- are not supported.
+    class DigitReference {
+    public:
+        operator char() const { return owner.at(index); }
+
+        DigitReference &operator=(char digit);
+
+        DigitReference &operator=(const DigitReference &other) { return *this = static_cast<char>(other); }
+
+        DigitReference &operator+=(char delta) { return *this = static_cast<char>(*this + delta); }
+
+        DigitReference &operator-=(char delta) { return *this = static_cast<char>(*this - delta); }
+
+    private:
+        friend class BigInteger;
+
+        DigitReference(BigInteger &owner, size_t index) : owner(owner), index(index) {}
+
+        BigInteger &owner;
+        size_t index;
+    };
 
     static char compareAbsolute(const BigInteger &num1, const BigInteger &num2);
 
     [[nodiscard]] std::string toString() const;
 
+    // Digits in radix 10 or 2^k for k = 1..6, the power-of-two radices in
+    // linear time. Up to radix 32 the digits are 0-9 then a-v; radix 64 uses
+    // the RFC 4648 base64 alphabet A-Z a-z 0-9 + / with 'A' for zero.
+    [[nodiscard]] std::string toString(unsigned radix) const;
+
+    // Room toChars() needs at most for the decimal form, sign included
+    [[nodiscard]] size_t decimalSizeUpperBound() const;
+
+    // Writes the value, in a radix toString() takes, to [first, last) like
+    // std::to_chars: returns the end of the text, or last and
+    // std::errc::value_too_large when it does not fit. Nothing is allocated
+    // when a decimal form gets decimalSizeUpperBound() chars of room.
+    std::to_chars_result toChars(char *first, char *last, unsigned radix = 10) const;
+
+    // Parses an optional '-' and digits in one of the radices toString()
+    // takes, letters in either case up to radix 32
+    static BigInteger fromString(const std::string &text, unsigned radix = 10);
+
+    enum class ByteOrder { BigEndian, LittleEndian };
+
+    // The integer in bytes[0..size): unsigned, or two's complement if isSigned
+    static BigInteger fromBytes(const void *bytes, size_t size, ByteOrder order = ByteOrder::BigEndian,
+                                bool isSigned = false);
+
+    // Fewest bytes toBytes() can write the value in
+    [[nodiscard]] size_t byteLength(bool isSigned = false) const;
+
+    // Writes the value to buffer[0..size), padded to fill it, as unsigned or
+    // two's complement bytes; throws when it does not fit
+    void toBytes(void *buffer, size_t size, ByteOrder order = ByteOrder::BigEndian, bool isSigned = false) const;
+
+    // Decimal digit at index, counting from the most significant digit.
+    // Each call converts the whole value to decimal, so to walk the digits
+    // take toString() once instead.
     [[nodiscard]] char at(size_t index) const;
 
-    char& operator[](size_t index);
+    // Reading the digit costs an at(); writing one converts the value once
+    // and adds a multiple of a power of ten
+    DigitReference operator[](size_t index);
 
+    // Number of decimal digits, read off log10 of the top limbs in constant
+    // time unless that lands next to an integer; then found by comparing with
+    // a power of ten about the size of the value
     size_t size() const;
 
+    [[nodiscard]] size_t bitLength() const;
+
+    [[nodiscard]] bool isOdd() const { return !data.empty() && (data[0] & 1) != 0; }
+
+    // The value as a long long, or nothing when it is out of range
+    [[nodiscard]] std::optional<long long> toLongLong() const;
+
 private:
+    friend class ModularContext;
+    friend class MontgomeryContext;
+    friend class NumberTheory;
+    friend class BigIntegerView;
+    friend class DecimalParser;
+    friend class Reduction;
+
     bool negative;
 
-    void selfPlus(const BigInteger &h);
+    // *this += (-1)^bNegative b[0..bn), in place; b must not point into data
+    void addSigned(const uint64_t *b, size_t bn, bool bNegative);
+
+    // *this += (-1)^productNegative a * b, in place
+    void addProduct(const BigInteger &a, const BigInteger &b, bool productNegative);
+
+    void selfPlus(const uint64_t *b, size_t bn);
+
+    // |*this| -= b, requires |*this| >= b
+    void selfMinus(const uint64_t *b, size_t bn);
+
+    // |*this| = b - |*this|, requires b > |*this|; the sign is left to the caller
+    void selfMinusFrom(const uint64_t *b, size_t bn);
 
-    void selfMinus(const BigInteger &h);
+    // Drops high zero limbs and clears the sign of zero
+    void normalize();
 
-    std::vector<char> data;
+    // r = a[0..an) * b[0..bn), an, bn >= 1, resizing r; r must not hold a or b
+    static void multiplyLimbs(LimbVector &r, const uint64_t *a, size_t an, const uint64_t *b, size_t bn);
+
+    // Truncating division of (-1)^aNegative a[0..an) by (-1)^dNegative d[0..dn),
+    // both without high zero limbs; quotient and remainder may own a or d
+    static void divideLimbs(const uint64_t *a, size_t an, bool aNegative, const uint64_t *d, size_t dn,
+                            bool dNegative, BigInteger &quotient, BigInteger &remainder);
+
+    void parseDecimal(const char *first, const char *last);
+
+    static BigInteger powerOfTen(size_t exponent);
+
+    // Magnitude in base 2^64, least significant limb first, no high zero limbs
+    LimbVector data;
     void divideAndRemainder
         (const BigInteger &divisor, BigInteger &quotient, BigInteger &remainder) const;
 
 };
 
+BigInteger pow(const BigInteger &base, uint64_t exponent);
+
+// Writes x as the stream's flags say: the base (dec, hex or oct), showbase,
+// showpos (decimal only, as for the built-in integers), uppercase, the
+// width with its fill and adjustment, and the digit grouping of the
+// stream's locale. See Formatting.h.
+std::ostream &operator<<(std::ostream &out, const BigInteger &x);
+
 #endif //BIGINTEGER_BIGINTEGER_H
@@ -0,0 +1,226 @@
+#include "LimbArithmetic.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <deque>
+#include <mutex>
+
+namespace limbs {
+
+namespace {
+    // Largest power of ten that fits in a limb
+    constexpr limb_t DECIMAL_CHUNK = 10000000000000000000ULL;
+    constexpr size_t DECIMAL_CHUNK_DIGITS = 19;
+
+    // Sizes below which the quadratic chunk-at-a-time conversions win
+    constexpr size_t DC_GET_STR_THRESHOLD = 30;                              // limbs
+    constexpr size_t DC_SET_STR_THRESHOLD = 40 * DECIMAL_CHUNK_DIGITS;       // digits
+
+    // Powers 10^(19 2^k), each the square of the one before, built on first
+    // use and shared by every conversion. Entries never move once created.
+    class PowerTable {
+    public:
+        const std::vector<limb_t> &power(size_t k) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (powers.empty()) powers.push_back({DECIMAL_CHUNK});
+            while (powers.size() <= k) {
+                const std::vector<limb_t> &last = powers.back();
+                std::vector<limb_t> square(2 * last.size());
+                sqr(square.data(), last.data(), last.size());
+                square.resize(normalized_size(square.data(), square.size()));
+                powers.push_back(std::move(square));
+            }
+            return powers[k];
+        }
+
+        static size_t digits(size_t k) { return DECIMAL_CHUNK_DIGITS << k; }
+
+    private:
+        std::mutex mutex;
+        std::deque<std::vector<limb_t>> powers;
+    };
+
+    PowerTable &powerTable() {
+        static PowerTable instance;
+        return instance;
+    }
+
+    void write_chunk(limb_t chunk, char *end, size_t width) {
+        for (size_t i = 0; i < width; ++i) {
+            *--end = static_cast<char>('0' + chunk % 10);
+            chunk /= 10;
+        }
+    }
+
+    // Writes x[0..n) as exactly width digits, zero padded, into out. x is destroyed.
+    void get_str_padded(limb_t *x, size_t n, char *out, size_t width) {
+        n = normalized_size(x, n);
+        if (n < DC_GET_STR_THRESHOLD) {
+            char *end = out + width;
+            while (n > 0 && end > out) {
+                limb_t chunk = divrem_1(x, x, n, DECIMAL_CHUNK);
+                size_t chunkWidth = std::min<size_t>(DECIMAL_CHUNK_DIGITS, end - out);
+                write_chunk(chunk, end, chunkWidth);
+                end -= chunkWidth;
+                n = normalized_size(x, n);
+            }
+            std::fill(out, end, '0');
+            return;
+        }
+
+        // Split by the largest cached power with at most half the limbs of x
+        PowerTable &table = powerTable();
+        size_t k = 0;
+        while (table.power(k + 1).size() * 2 <= n) ++k;
+        const std::vector<limb_t> &divisor = table.power(k);
+        size_t dn = divisor.size(), lowWidth = PowerTable::digits(k);
+        scratch_vector quotient(n - dn + 1, scratch_resource()), remainder(dn, scratch_resource());
+        divrem(quotient.data(), remainder.data(), x, n, divisor.data(), dn);
+        get_str_padded(quotient.data(), quotient.size(), out, width - lowWidth);
+        get_str_padded(remainder.data(), dn, out + width - lowWidth, lowWidth);
+    }
+
+    // Horner's rule over chunks of up to 19 digits, the leading chunk taking the remainder
+    scratch_vector set_str_basecase(const char *first, const char *last) {
+        scratch_vector result(scratch_resource());
+        size_t chunkLength = (last - first) % DECIMAL_CHUNK_DIGITS;
+        if (chunkLength == 0) chunkLength = DECIMAL_CHUNK_DIGITS;
+        while (first != last) {
+            limb_t chunk = 0, scale = 1;
+            for (const char *end = first + chunkLength; first != end; ++first) {
+                chunk = chunk * 10 + (*first - '0');
+                scale *= 10;
+            }
+            limb_t carry = mul_1(result.data(), result.data(), result.size(), scale);
+            if (carry) result.push_back(carry);
+            carry = add_1(result.data(), result.data(), result.size(), chunk);
+            if (carry) result.push_back(carry);
+            chunkLength = DECIMAL_CHUNK_DIGITS;
+        }
+        return result;
+    }
+
+    scratch_vector set_str_recursive(const char *first, const char *last) {
+        size_t length = last - first;
+        if (length < DC_SET_STR_THRESHOLD) return set_str_basecase(first, last);
+
+        // Split off the largest power-of-two block of chunks that leaves the high part at least as long
+        size_t k = 0;
+        while (PowerTable::digits(k + 1) * 2 <= length) ++k;
+        const char *split = last - PowerTable::digits(k);
+        scratch_vector high = set_str_recursive(first, split);
+        scratch_vector low = set_str_recursive(split, last);
+        const std::vector<limb_t> &scale = powerTable().power(k);
+
+        scratch_vector result(high.size() + scale.size() + 1, 0, scratch_resource());
+        if (!high.empty()) {
+            if (high.size() >= scale.size()) mul(result.data(), high.data(), high.size(), scale.data(), scale.size());
+            else mul(result.data(), scale.data(), scale.size(), high.data(), high.size());
+        }
+        if (!low.empty()) add(result.data(), result.data(), result.size(), low.data(), low.size());
+        result.resize(normalized_size(result.data(), result.size()));
+        return result;
+    }
+
+    const char RADIX32_DIGITS[] = "0123456789abcdefghijklmnopqrstuv";
+    const char RADIX64_DIGITS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    // Digit values of every character, -1 where there is none
+    struct DigitTable {
+        signed char values[256];
+
+        explicit DigitTable(const char *digits, bool anyCase) {
+            std::fill(std::begin(values), std::end(values), -1);
+            for (int i = 0; digits[i]; ++i) {
+                auto c = static_cast<unsigned char>(digits[i]);
+                values[c] = static_cast<signed char>(i);
+                if (anyCase) values[std::toupper(c)] = static_cast<signed char>(i);
+            }
+        }
+    };
+
+    const DigitTable &digitTable(unsigned bits) {
+        static const DigitTable radix32(RADIX32_DIGITS, true), radix64(RADIX64_DIGITS, false);
+        return bits == 6 ? radix64 : radix32;
+    }
+}
+
+char *to_decimal(char *out, const limb_t *a, size_t n) {
+    if (n == 1) return std::to_chars(out, out + decimal_size_bound(1), a[0]).ptr;
+    size_t width = decimal_size_bound(n);
+    scratch_vector scratch(a, a + n, scratch_resource());
+    get_str_padded(scratch.data(), n, out, width);
+    char *digits = std::find_if(out, out + width - 1, [](char c) { return c != '0'; });
+    return std::copy(digits, out + width, out);
+}
+
+std::string to_decimal(const limb_t *a, size_t n) {
+    std::string rtn(decimal_size_bound(n), '0');
+    rtn.resize(to_decimal(rtn.data(), a, n) - rtn.data());
+    return rtn;
+}
+
+std::vector<limb_t> from_decimal(const char *first, const char *last) {
+    scratch_vector result = set_str_recursive(first, last);
+    return {result.begin(), result.end()};
+}
+
+std::vector<limb_t> power_of_ten(size_t exponent) {
+    // 10^(exponent mod 19), times the cached 10^(19 2^k) for each bit k of
+    // exponent / 19. Their low zero limbs are left out of the products and
+    // put back at the end.
+    limb_t low = 1;
+    for (size_t i = 0; i < exponent % DECIMAL_CHUNK_DIGITS; ++i) low *= 10;
+    std::vector<limb_t> result{low};
+    size_t zeros = 0;
+    PowerTable &table = powerTable();
+    for (size_t k = 0, chunks = exponent / DECIMAL_CHUNK_DIGITS; chunks != 0; ++k, chunks >>= 1) {
+        if ((chunks & 1) == 0) continue;
+        const std::vector<limb_t> &power = table.power(k);
+        size_t skip = 0;
+        while (power[skip] == 0) ++skip;
+        const limb_t *p = power.data() + skip;
+        size_t pn = power.size() - skip;
+        std::vector<limb_t> product(result.size() + pn);
+        if (result.size() >= pn) mul(product.data(), result.data(), result.size(), p, pn);
+        else mul(product.data(), p, pn, result.data(), result.size());
+        product.resize(normalized_size(product.data(), product.size()));
+        result = std::move(product);
+        zeros += skip;
+    }
+    result.insert(result.begin(), zeros, 0);
+    return result;
+}
+
+int radix_digit(char c, unsigned bits) {
+    int value = digitTable(bits).values[static_cast<unsigned char>(c)];
+    return value < (1 << bits) ? value : -1;
+}
+
+char *to_radix_pow2(char *out, const limb_t *a, size_t n, unsigned bits) {
+    const char *digits = bits == 6 ? RADIX64_DIGITS : RADIX32_DIGITS;
+    size_t length = (n * LIMB_BITS - __builtin_clzll(a[n - 1]) + bits - 1) / bits;
+    limb_t mask = (limb_t(1) << bits) - 1;
+    // Digit i from the low end holds bits [i bits, (i + 1) bits), perhaps straddling two limbs
+    for (size_t i = 0, bit = 0; i < length; ++i, bit += bits) {
+        size_t limb = bit / LIMB_BITS, shift = bit % LIMB_BITS;
+        limb_t value = a[limb] >> shift;
+        if (shift + bits > LIMB_BITS && limb + 1 < n) value |= a[limb + 1] << (LIMB_BITS - shift);
+        out[length - 1 - i] = digits[value & mask];
+    }
+    return out + length;
+}
+
+void from_radix_pow2(limb_t *r, const char *first, const char *last, unsigned bits) {
+    const signed char *values = digitTable(bits).values;
+    size_t bit = 0;
+    for (const char *it = last; it != first; bit += bits) {
+        auto value = static_cast<limb_t>(values[static_cast<unsigned char>(*--it)]);
+        size_t limb = bit / LIMB_BITS, shift = bit % LIMB_BITS;
+        r[limb] |= value << shift;
+        if (shift + bits > LIMB_BITS) r[limb + 1] |= value >> (LIMB_BITS - shift);
+    }
+}
+
+}
@@ -0,0 +1,169 @@
+#include "DecimalParser.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <unistd.h>
+
+namespace {
+    // Digits converted at a time, 4096 limbs' worth, well into the range
+    // where limbs::from_decimal divides and conquers
+    constexpr size_t BLOCK_DIGITS = 19 * 4096;
+
+    // Bytes read from a file descriptor at a time
+    constexpr size_t READ_CHUNK = 1 << 16;
+
+    bool isDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+    }
+}
+
+size_t DecimalParser::feed(std::string_view chunk) {
+    const char *first = chunk.data(), *last = first + chunk.size(), *it = first;
+    while (it != last && state != State::Done) {
+        if (state == State::Leading) {
+            if (isSpace(*it)) {
+                ++it;
+                continue;
+            }
+            state = State::Digits;
+            if (*it == '-') {
+                negative = true;
+                ++it;
+                continue;
+            }
+        }
+        const char *run = it;
+        while (it != last && isDigit(*it)) ++it;
+        if (it != run) {
+            appendDigits(run, it);
+            anyDigit = true;
+        }
+        if (it == last) break;
+        if (!anyDigit || !isSpace(*it)) throw std::runtime_error("Invalid integer");
+        state = State::Done;
+    }
+    auto taken = static_cast<size_t>(it - first);
+    consumed += taken;
+    return taken;
+}
+
+BigInteger DecimalParser::finish() {
+    if (!anyDigit) throw std::runtime_error("Invalid integer");
+    BigInteger result;
+    result.parseDecimal(pending.data(), pending.data() + pending.size());
+    // Add the segments in from the least significant, scale being 10 to the
+    // number of digits below the next one
+    BigInteger scale = BigInteger::powerOfTen(pending.size());
+    for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
+        result += it->value * scale;
+        if (it + 1 != segments.rend()) scale *= tenPower(it->level);
+    }
+    result.negative = negative && !result.data.empty();
+
+    state = State::Leading;
+    negative = anyDigit = false;
+    consumed = 0;
+    pending.clear();
+    segments.clear();
+    return result;
+}
+
+void DecimalParser::appendDigits(const char *first, const char *last) {
+    while (first != last) {
+        auto available = static_cast<size_t>(last - first);
+        // Whole blocks are converted from the caller's text without a copy
+        if (pending.empty() && available >= BLOCK_DIGITS) {
+            pushBlock(first, first + BLOCK_DIGITS);
+            first += BLOCK_DIGITS;
+            continue;
+        }
+        size_t take = std::min(BLOCK_DIGITS - pending.size(), available);
+        pending.append(first, take);
+        first += take;
+        if (pending.size() == BLOCK_DIGITS) {
+            pushBlock(pending.data(), pending.data() + pending.size());
+            pending.clear();
+        }
+    }
+}
+
+void DecimalParser::pushBlock(const char *first, const char *last) {
+    BigInteger block;
+    block.parseDecimal(first, last);
+    size_t level = 0;
+    while (!segments.empty() && segments.back().level == level) {
+        BigInteger high = std::move(segments.back().value);
+        segments.pop_back();
+        high *= tenPower(level);
+        high += block;
+        block = std::move(high);
+        ++level;
+    }
+    segments.push_back({std::move(block), level});
+}
+
+BigInteger DecimalParser::tenPower(size_t level) {
+    return BigInteger::powerOfTen(BLOCK_DIGITS << level);
+}
+
+BigInteger parseDecimal(std::istream &in, size_t *consumed) {
+    using traits = std::istream::traits_type;
+    std::istream::sentry sentry(in, true);
+    if (!sentry) throw std::runtime_error("Invalid integer");
+    DecimalParser parser;
+    std::streambuf *buffer = in.rdbuf();
+    std::string digits;
+    // Characters are taken one at a time, so the one that ends the number
+    // stays in the stream; digits are handed on in batches
+    for (;;) {
+        traits::int_type c = buffer->sgetc();
+        if (traits::eq_int_type(c, traits::eof())) {
+            in.setstate(std::ios::eofbit);
+            break;
+        }
+        char ch = traits::to_char_type(c);
+        if (isDigit(ch)) {
+            digits += ch;
+            buffer->sbumpc();
+            if (digits.size() == BLOCK_DIGITS) {
+                parser.feed(digits);
+                digits.clear();
+            }
+            continue;
+        }
+        parser.feed(digits);
+        digits.clear();
+        if (parser.feed(std::string_view(&ch, 1)) == 0) break;
+        buffer->sbumpc();
+    }
+    parser.feed(digits);
+    if (consumed) *consumed = parser.bytesConsumed();
+    return parser.finish();
+}
+
+BigInteger parseDecimalFd(int fd, size_t *consumed, std::string *unread) {
+    DecimalParser parser;
+    std::string chunk(READ_CHUNK, '\0');
+    std::string_view rest;
+    while (!parser.done()) {
+        ssize_t got = ::read(fd, chunk.data(), chunk.size());
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Failed to read the integer");
+        }
+        if (got == 0) break;
+        std::string_view view(chunk.data(), static_cast<size_t>(got));
+        rest = view.substr(parser.feed(view));
+    }
+    if (unread) unread->clear();
+    // Bytes read past the number go back to the file, or failing that to the caller
+    if (!rest.empty() && ::lseek(fd, -static_cast<off_t>(rest.size()), SEEK_CUR) == -1 && unread) {
+        unread->assign(rest);
+    }
+    if (consumed) *consumed = parser.bytesConsumed();
+    return parser.finish();
+}
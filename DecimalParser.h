@@ -0,0 +1,80 @@
+#ifndef BIGINTEGER_DECIMALPARSER_H
+#define BIGINTEGER_DECIMALPARSER_H
+
+#include "BigInteger.h"
+
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Incremental parser for the decimal text of one integer: leading
+// whitespace, an optional '-', then digits, ending at whitespace or with the
+// input. The text may arrive in chunks of any size. Digits are converted a
+// block at a time, and converted blocks are combined pairwise like the
+// digits of a binary counter, so the work is that of converting the whole
+// number at once while the memory held is about the size of the result.
+class DecimalParser {
+public:
+    // Takes what belongs to the number from the front of chunk and returns
+    // its length, which falls short of chunk.size() once whitespace ends the
+    // number. Throws on any other character.
+    size_t feed(std::string_view chunk);
+
+    // Whether whitespace after the digits has ended the number
+    [[nodiscard]] bool done() const { return state == State::Done; }
+
+    // Bytes taken by feed() so far
+    [[nodiscard]] size_t bytesConsumed() const { return consumed; }
+
+    // The value parsed; throws when no digit came. Leaves the parser empty.
+    BigInteger finish();
+
+private:
+    enum class State { Leading, Digits, Done };
+
+    // Converted run of digits; its level k means BLOCK_DIGITS 2^k of them
+    struct Segment {
+        BigInteger value;
+        size_t level;
+    };
+
+    State state = State::Leading;
+    bool negative = false;
+    bool anyDigit = false;
+    size_t consumed = 0;
+    // Digits not yet converted, fewer than a block
+    std::string pending;
+    // Most significant first, levels strictly decreasing
+    std::vector<Segment> segments;
+
+    void appendDigits(const char *first, const char *last);
+
+    void pushBlock(const char *first, const char *last);
+
+    // 10^(BLOCK_DIGITS 2^level), from the shared cache of powers of ten
+    static BigInteger tenPower(size_t level);
+};
+
+// The integer at the front of in, leaving the whitespace that ends it in the
+// stream; consumed, if given, gets the bytes taken
+BigInteger parseDecimal(std::istream &in, size_t *consumed = nullptr);
+
+// The same, reading the file descriptor fd to the end of the number. Bytes
+// read past it are sought back over when fd is seekable; otherwise, as on a
+// pipe or socket, they are stored in unread, if given, and lost if not.
+BigInteger parseDecimalFd(int fd, size_t *consumed = nullptr, std::string *unread = nullptr);
+
+// The same over a sequence of chunks, e.g. a std::vector<std::string_view>
+template<typename Chunks>
+BigInteger parseDecimalChunks(const Chunks &chunks, size_t *consumed = nullptr) {
+    DecimalParser parser;
+    for (std::string_view chunk: chunks) {
+        if (parser.feed(chunk) < chunk.size()) break;
+    }
+    if (consumed) *consumed = parser.bytesConsumed();
+    return parser.finish();
+}
+
+#endif //BIGINTEGER_DECIMALPARSER_H
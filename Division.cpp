@@ -0,0 +1,149 @@
+#include "LimbArithmetic.h"
+#include "Instrumentation.h"
+
+#include <algorithm>
+
+namespace limbs {
+
+namespace {
+    // Divisor size, in limbs, from which divide-and-conquer beats schoolbook division
+    constexpr size_t DC_DIV_THRESHOLD = 40;
+
+    // Scratch size, in limbs, up to which divrem() stays on the stack
+    constexpr size_t SMALL_DIVISION_LIMBS = 64;
+
+    // Knuth's Algorithm D. Divides np[0..nn) by the normalized dp[0..dn),
+    // dn >= 2, writing nn - dn quotient limbs to q and leaving the remainder
+    // in np[0..dn). Returns the extra high quotient limb (0 or 1) needed when
+    // the top dn limbs of np are not below dp.
+    limb_t divrem_basecase(limb_t *q, limb_t *np, size_t nn, const limb_t *dp, size_t dn) {
+        limb_t qh = cmp(np + nn - dn, dp, dn) >= 0;
+        if (qh) sub_n(np + nn - dn, np + nn - dn, dp, dn);
+
+        const limb_t d1 = dp[dn - 1], d0 = dp[dn - 2];
+        for (size_t i = nn - dn; i-- > 0;) {
+            limb_t n2 = np[i + dn], n1 = np[i + dn - 1], n0 = np[i + dn - 2];
+            // Estimate from the top three numerator limbs and two divisor limbs;
+            // the result is at most one too large
+            limb_t qhat, rhat;
+            bool rhatOverflow;
+            if (n2 >= d1) {
+                qhat = ~static_cast<limb_t>(0);
+                rhat = n1 + d1;
+                rhatOverflow = rhat < n1;
+            } else {
+                dlimb_t numerator = (static_cast<dlimb_t>(n2) << LIMB_BITS) | n1;
+                qhat = static_cast<limb_t>(numerator / d1);
+                rhat = static_cast<limb_t>(numerator % d1);
+                rhatOverflow = false;
+            }
+            while (!rhatOverflow &&
+                   static_cast<dlimb_t>(qhat) * d0 > ((static_cast<dlimb_t>(rhat) << LIMB_BITS) | n0)) {
+                --qhat;
+                rhat += d1;
+                rhatOverflow = rhat < d1;
+            }
+
+            limb_t borrow = submul_1(np + i, dp, dn, qhat);
+            if (n2 < borrow) {
+                --qhat;
+                add_n(np + i, np + i, dp, dn);
+            }
+            np[i + dn] = 0;
+            q[i] = qhat;
+        }
+        return qh;
+    }
+
+    limb_t divrem_dc_n(limb_t *q, limb_t *np, const limb_t *dp, size_t n);
+
+    // Divides np[0..dn+k) by the normalized dp[0..dn) for k <= dn, writing k
+    // quotient limbs to q and leaving the remainder in np[0..dn). The quotient
+    // is estimated from the top 2k numerator limbs and top k divisor limbs,
+    // then corrected against the low part of the divisor.
+    limb_t divrem_block(limb_t *q, limb_t *np, size_t k, const limb_t *dp, size_t dn) {
+        if (k < DC_DIV_THRESHOLD) return divrem_basecase(q, np, dn + k, dp, dn);
+
+        limb_t qh = divrem_dc_n(q, np + dn - k, dp + dn - k, k);
+        if (dn == k) return qh;
+
+        scratch_vector product(dn, scratch_resource());
+        if (k >= dn - k) mul(product.data(), q, k, dp, dn - k);
+        else mul(product.data(), dp, dn - k, q, k);
+        limb_t borrow = sub_n(np, np, product.data(), dn);
+        if (qh) borrow += sub_n(np + k, np + k, dp, dn - k);
+        while (borrow) {
+            qh -= sub_1(q, q, k, 1);
+            borrow -= add_n(np, np, dp, dn);
+        }
+        return qh;
+    }
+
+    // Divides np[0..2n) by the normalized dp[0..n): quotient in q[0..n),
+    // remainder in np[0..n), returns the high quotient limb
+    limb_t divrem_dc_n(limb_t *q, limb_t *np, const limb_t *dp, size_t n) {
+        size_t low = n / 2, high = n - low;
+        limb_t qh = divrem_block(q + low, np + low, high, dp, n);
+        divrem_block(q, np, low, dp, n);
+        return qh;
+    }
+
+    // Divides np[0..nn) by the normalized dp[0..dn), quotient blocks of dn
+    // limbs at a time from the top, the first block taking the odd size
+    limb_t divrem_dc(limb_t *q, limb_t *np, size_t nn, const limb_t *dp, size_t dn) {
+        size_t qn = nn - dn;
+        size_t block = qn % dn == 0 ? dn : qn % dn;
+        size_t offset = qn - block;
+        limb_t qh = divrem_block(q + offset, np + offset, block, dp, dn);
+        while (offset > 0) {
+            offset -= dn;
+            divrem_block(q + offset, np + offset, dn, dp, dn);
+        }
+        return qh;
+    }
+}
+
+void divrem(limb_t *q, limb_t *r, const limb_t *a, size_t an, const limb_t *d, size_t dn) {
+    if (dn == 1) {
+        instrumentation::recordAlgorithm(instrumentation::Algorithm::DivideOneLimb);
+        r[0] = divrem_1(q, a, an, d[0]);
+        return;
+    }
+
+    // Normalize so that the divisor's top bit is set; the extra numerator limb
+    // keeps the top dn numerator limbs below the divisor. Small divisions
+    // work in a stack buffer, larger ones in the scratch pool.
+    size_t nn = an + 1, qn = nn - dn;
+    limb_t stackBuffer[SMALL_DIVISION_LIMBS];
+    scratch_vector heapBuffer(scratch_resource());
+    limb_t *divisor = stackBuffer;
+    if (dn + nn + qn > SMALL_DIVISION_LIMBS) {
+        heapBuffer.resize(dn + nn + qn);
+        divisor = heapBuffer.data();
+    }
+    limb_t *numerator = divisor + dn, *quotient = numerator + nn;
+
+    unsigned shift = __builtin_clzll(d[dn - 1]);
+    if (shift) {
+        lshift(divisor, d, dn, shift);
+        numerator[an] = lshift(numerator, a, an, shift);
+    } else {
+        std::copy(d, d + dn, divisor);
+        std::copy(a, a + an, numerator);
+        numerator[an] = 0;
+    }
+
+    if (dn < DC_DIV_THRESHOLD || qn < DC_DIV_THRESHOLD) {
+        instrumentation::recordAlgorithm(instrumentation::Algorithm::DivideSchoolbook);
+        divrem_basecase(quotient, numerator, nn, divisor, dn);
+    } else {
+        instrumentation::recordAlgorithm(instrumentation::Algorithm::DivideDivideAndConquer);
+        divrem_dc(quotient, numerator, nn, divisor, dn);
+    }
+
+    std::copy(quotient, quotient + qn, q);
+    if (shift) rshift(r, numerator, dn, shift);
+    else std::copy(numerator, numerator + dn, r);
+}
+
+}
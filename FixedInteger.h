@@ -0,0 +1,485 @@
+#ifndef BIGINTEGER_FIXEDINTEGER_H
+#define BIGINTEGER_FIXEDINTEGER_H
+
+#include "BigInteger.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+// What a FixedInteger does with a result outside its range: keep its low
+// bits like the built-in unsigned types, or throw std::runtime_error. In a
+// constant expression a checked overflow is a compile-time error.
+enum class OverflowPolicy { Wrap, Checked };
+
+// Integer of exactly Bits bits, a multiple of 64, in limbs on the stack:
+// unsigned, or two's complement when Signed. It has the operators of
+// BigInteger, with division truncating toward zero and >> rounding toward
+// negative infinity, plus the bitwise ones. Addition, subtraction and
+// multiplication are unrolled at compile time over the limbs. Everything
+// but the conversions to and from BigInteger is constexpr, so constants
+// can be computed while compiling, e.g.
+//
+//   constexpr auto P = FixedInteger<256, false>::parse("ffffffff00000001000000000000000000000000ffffffffffffffffffffffff", 16);
+template<size_t Bits, bool Signed = true, OverflowPolicy Policy = OverflowPolicy::Wrap>
+class FixedInteger {
+    static_assert(Bits >= 64 && Bits % 64 == 0, "FixedInteger needs a positive multiple of 64 bits");
+
+public:
+    using limb_t = uint64_t;
+
+    static constexpr size_t LIMBS = Bits / 64;
+
+    constexpr FixedInteger() : limbs{} {}
+
+    template<typename T, typename std::enable_if<std::is_integral<T>::value>::type * = nullptr>
+    constexpr FixedInteger(T value) : limbs{} {
+        bool negative = false;
+        if constexpr (std::is_signed<T>::value) negative = value < 0;
+        // Two's complement bits of the value, sign-extended to 128
+        auto bits = static_cast<dlimb_t>(value);
+        limb_t fill = negative ? ~limb_t(0) : 0;
+        for (size_t i = 0; i < LIMBS; ++i) limbs[i] = i < 2 ? static_cast<limb_t>(bits >> (64 * i)) : fill;
+        if constexpr (Policy == OverflowPolicy::Checked) {
+            bool fits = isNegative() == negative;
+            if (LIMBS == 1) fits = fits && static_cast<limb_t>(bits >> 64) == signFill();
+            if (!fits) overflow();
+        }
+    }
+
+    // x, or with Wrap its value modulo 2^Bits when it is out of range
+    explicit FixedInteger(const BigInteger &x) : limbs{} {
+        unsigned char bytes[BYTES] = {};
+        bool fits = Signed ? x.byteLength(true) <= BYTES : x >= BigInteger(0) && x.byteLength() <= BYTES;
+        if (fits) {
+            x.toBytes(bytes, BYTES, BigInteger::ByteOrder::LittleEndian, Signed);
+        } else {
+            if constexpr (Policy == OverflowPolicy::Checked) overflow();
+            // x mod 2^Bits, whose bits are the low ones of x in two's complement
+            BigInteger low = x - ((x >> Bits) << Bits);
+            low.toBytes(bytes, BYTES, BigInteger::ByteOrder::LittleEndian, false);
+        }
+        for (size_t i = 0; i < BYTES; ++i) limbs[i / 8] |= static_cast<limb_t>(bytes[i]) << (8 * (i % 8));
+    }
+
+    // Parses an optional '-' and digits 0-9 then a-z in either case, in
+    // radix 2 to 36; throws for anything else or, if checked, a value out of
+    // range
+    static constexpr FixedInteger parse(std::string_view text, unsigned radix = 10) {
+        if (radix < 2 || radix > 36) throw std::runtime_error("Unsupported radix");
+        bool negative = !text.empty() && text[0] == '-';
+        if (negative) text.remove_prefix(1);
+        if (text.empty()) throw std::runtime_error("Invalid integer");
+        FixedInteger result;
+        bool carried = false;
+        for (char c: text) {
+            unsigned digit = c >= '0' && c <= '9' ? c - '0'
+                             : c >= 'a' && c <= 'z' ? c - 'a' + 10
+                             : c >= 'A' && c <= 'Z' ? c - 'A' + 10 : 36;
+            if (digit >= radix) throw std::runtime_error("Invalid integer");
+            carried |= mulAdd1(result.limbs, radix, digit) != 0;
+        }
+        if constexpr (Policy == OverflowPolicy::Checked) {
+            // The magnitude must be below 2^Bits, and for Signed below 2^(Bits - 1)
+            // or equal to it when negative
+            bool topBit = (result.limbs[LIMBS - 1] >> 63) != 0;
+            bool fits = !carried && (Signed ? !topBit || (negative && result == min()) : !negative || result == 0);
+            if (!fits) overflow();
+        }
+        return negative ? negated(result) : result;
+    }
+
+    static constexpr FixedInteger max() {
+        FixedInteger result;
+        for (limb_t &limb: result.limbs) limb = ~limb_t(0);
+        if (Signed) result.limbs[LIMBS - 1] >>= 1;
+        return result;
+    }
+
+    static constexpr FixedInteger min() {
+        FixedInteger result;
+        if (Signed) result.limbs[LIMBS - 1] = limb_t(1) << 63;
+        return result;
+    }
+
+    // Lossless whatever the value
+    [[nodiscard]] BigInteger toBigInteger() const {
+        unsigned char bytes[BYTES];
+        for (size_t i = 0; i < BYTES; ++i) bytes[i] = static_cast<unsigned char>(limbs[i / 8] >> (8 * (i % 8)));
+        return BigInteger::fromBytes(bytes, BYTES, BigInteger::ByteOrder::LittleEndian, Signed);
+    }
+
+    [[nodiscard]] std::string toString(unsigned radix = 10) const {
+        return toBigInteger().toString(radix);
+    }
+
+    // The two's complement limbs, least significant first
+    [[nodiscard]] constexpr const limb_t *data() const { return limbs; }
+
+    [[nodiscard]] constexpr bool isNegative() const { return Signed && (limbs[LIMBS - 1] >> 63) != 0; }
+
+    constexpr FixedInteger &operator+=(const FixedInteger &h) { return *this = *this + h; }
+
+    constexpr FixedInteger &operator-=(const FixedInteger &h) { return *this = *this - h; }
+
+    constexpr FixedInteger &operator*=(const FixedInteger &h) { return *this = *this * h; }
+
+    constexpr FixedInteger &operator/=(const FixedInteger &h) { return *this = *this / h; }
+
+    constexpr FixedInteger &operator%=(const FixedInteger &h) { return *this = *this % h; }
+
+    constexpr FixedInteger &operator&=(const FixedInteger &h) { return *this = *this & h; }
+
+    constexpr FixedInteger &operator|=(const FixedInteger &h) { return *this = *this | h; }
+
+    constexpr FixedInteger &operator^=(const FixedInteger &h) { return *this = *this ^ h; }
+
+    constexpr FixedInteger &operator<<=(size_t h) { return *this = *this << h; }
+
+    constexpr FixedInteger &operator>>=(size_t h) { return *this = *this >> h; }
+
+    constexpr FixedInteger &operator++() { return *this += 1; }
+
+    constexpr FixedInteger &operator--() { return *this -= 1; }
+
+    constexpr FixedInteger operator++(int) {
+        FixedInteger old = *this;
+        ++*this;
+        return old;
+    }
+
+    constexpr FixedInteger operator--(int) {
+        FixedInteger old = *this;
+        --*this;
+        return old;
+    }
+
+    constexpr FixedInteger operator+() const { return *this; }
+
+    constexpr FixedInteger operator-() const {
+        if constexpr (Policy == OverflowPolicy::Checked) {
+            if (Signed ? *this == min() : *this != 0) overflow();
+        }
+        return negated(*this);
+    }
+
+    constexpr FixedInteger operator~() const {
+        FixedInteger result;
+        for (size_t i = 0; i < LIMBS; ++i) result.limbs[i] = ~limbs[i];
+        return result;
+    }
+
+    friend constexpr FixedInteger operator+(const FixedInteger &a, const FixedInteger &b) {
+        FixedInteger r;
+        limb_t carry = addLimbs(r.limbs, a.limbs, b.limbs, Indices());
+        if constexpr (Policy == OverflowPolicy::Checked) {
+            bool overflowed = Signed ? a.isNegative() == b.isNegative() && r.isNegative() != a.isNegative() : carry != 0;
+            if (overflowed) overflow();
+        }
+        static_cast<void>(carry);
+        return r;
+    }
+
+    friend constexpr FixedInteger operator-(const FixedInteger &a, const FixedInteger &b) {
+        FixedInteger r;
+        limb_t borrow = subLimbs(r.limbs, a.limbs, b.limbs, Indices());
+        if constexpr (Policy == OverflowPolicy::Checked) {
+            bool overflowed = Signed ? a.isNegative() != b.isNegative() && r.isNegative() != a.isNegative() : borrow != 0;
+            if (overflowed) overflow();
+        }
+        static_cast<void>(borrow);
+        return r;
+    }
+
+    friend constexpr FixedInteger operator*(const FixedInteger &a, const FixedInteger &b) {
+        if constexpr (Policy == OverflowPolicy::Wrap) {
+            // The low Bits bits of a product are the same signed or not
+            FixedInteger r;
+            mulLow(r.limbs, a.limbs, b.limbs, Indices());
+            return r;
+        } else {
+            bool negative = a.isNegative() != b.isNegative();
+            FixedInteger x = magnitude(a), y = magnitude(b);
+            limb_t full[2 * LIMBS] = {};
+            mulFull(full, x.limbs, y.limbs, Indices());
+            FixedInteger r;
+            bool high = false;
+            for (size_t i = 0; i < LIMBS; ++i) {
+                r.limbs[i] = full[i];
+                high |= full[LIMBS + i] != 0;
+            }
+            bool topBit = (r.limbs[LIMBS - 1] >> 63) != 0;
+            if (high || (Signed && topBit && !(negative && r == min()))) overflow();
+            return negative ? negated(r) : r;
+        }
+    }
+
+    friend constexpr FixedInteger operator/(const FixedInteger &a, const FixedInteger &b) {
+        FixedInteger quotient, remainder;
+        divide(a, b, quotient, remainder);
+        return quotient;
+    }
+
+    friend constexpr FixedInteger operator%(const FixedInteger &a, const FixedInteger &b) {
+        FixedInteger quotient, remainder;
+        divide(a, b, quotient, remainder);
+        return remainder;
+    }
+
+    friend constexpr FixedInteger operator&(const FixedInteger &a, const FixedInteger &b) {
+        FixedInteger r;
+        for (size_t i = 0; i < LIMBS; ++i) r.limbs[i] = a.limbs[i] & b.limbs[i];
+        return r;
+    }
+
+    friend constexpr FixedInteger operator|(const FixedInteger &a, const FixedInteger &b) {
+        FixedInteger r;
+        for (size_t i = 0; i < LIMBS; ++i) r.limbs[i] = a.limbs[i] | b.limbs[i];
+        return r;
+    }
+
+    friend constexpr FixedInteger operator^(const FixedInteger &a, const FixedInteger &b) {
+        FixedInteger r;
+        for (size_t i = 0; i < LIMBS; ++i) r.limbs[i] = a.limbs[i] ^ b.limbs[i];
+        return r;
+    }
+
+    // Checked, it throws when a bit that matters is shifted out
+    friend constexpr FixedInteger operator<<(const FixedInteger &a, size_t h) {
+        FixedInteger r;
+        if (h < Bits) {
+            size_t limbShift = h / 64, bitShift = h % 64;
+            for (size_t i = LIMBS; i-- > limbShift;) {
+                r.limbs[i] = a.limbs[i - limbShift] << bitShift;
+                if (bitShift && i > limbShift) r.limbs[i] |= a.limbs[i - limbShift - 1] >> (64 - bitShift);
+            }
+        }
+        if constexpr (Policy == OverflowPolicy::Checked) {
+            if ((r >> h) != a) overflow();
+        }
+        return r;
+    }
+
+    friend constexpr FixedInteger operator>>(const FixedInteger &a, size_t h) {
+        limb_t fill = a.signFill();
+        FixedInteger r;
+        for (limb_t &limb: r.limbs) limb = fill;
+        if (h < Bits) {
+            size_t limbShift = h / 64, bitShift = h % 64;
+            for (size_t i = 0; i + limbShift < LIMBS; ++i) {
+                limb_t next = i + limbShift + 1 < LIMBS ? a.limbs[i + limbShift + 1] : fill;
+                r.limbs[i] = a.limbs[i + limbShift] >> bitShift;
+                if (bitShift) r.limbs[i] |= next << (64 - bitShift);
+            }
+        }
+        return r;
+    }
+
+    friend constexpr bool operator==(const FixedInteger &a, const FixedInteger &b) {
+        for (size_t i = 0; i < LIMBS; ++i) {
+            if (a.limbs[i] != b.limbs[i]) return false;
+        }
+        return true;
+    }
+
+    friend constexpr bool operator!=(const FixedInteger &a, const FixedInteger &b) { return !(a == b); }
+
+    friend constexpr bool operator<(const FixedInteger &a, const FixedInteger &b) { return compare(a, b) < 0; }
+
+    friend constexpr bool operator>(const FixedInteger &a, const FixedInteger &b) { return compare(a, b) > 0; }
+
+    friend constexpr bool operator<=(const FixedInteger &a, const FixedInteger &b) { return compare(a, b) <= 0; }
+
+    friend constexpr bool operator>=(const FixedInteger &a, const FixedInteger &b) { return compare(a, b) >= 0; }
+
+    friend std::ostream &operator<<(std::ostream &out, const FixedInteger &x) { return out << x.toBigInteger(); }
+
+private:
+    using dlimb_t = unsigned __int128;
+    using Indices = std::make_index_sequence<LIMBS>;
+
+    static constexpr size_t BYTES = Bits / 8;
+
+    limb_t limbs[LIMBS];
+
+    [[noreturn]] static void overflow() {
+        throw std::runtime_error("FixedInteger overflow");
+    }
+
+    // All ones for a negative value, else zero: the limbs beyond the top one
+    [[nodiscard]] constexpr limb_t signFill() const { return isNegative() ? ~limb_t(0) : 0; }
+
+    static constexpr int compare(const FixedInteger &a, const FixedInteger &b) {
+        if (a.isNegative() != b.isNegative()) return a.isNegative() ? -1 : 1;
+        return compareMagnitudes(a.limbs, b.limbs);
+    }
+
+    // Three-way comparison of the limbs as unsigned numbers
+    static constexpr int compareMagnitudes(const limb_t *a, const limb_t *b) {
+        for (size_t i = LIMBS; i-- > 0;) {
+            if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+        }
+        return 0;
+    }
+
+    static constexpr FixedInteger negated(const FixedInteger &a) {
+        FixedInteger zero;
+        FixedInteger r;
+        subLimbs(r.limbs, zero.limbs, a.limbs, Indices());
+        return r;
+    }
+
+    // |a| as the same bits; for the minimum of a signed type that is 2^(Bits - 1)
+    static constexpr FixedInteger magnitude(const FixedInteger &a) {
+        return a.isNegative() ? negated(a) : a;
+    }
+
+    // r = a + b over all the limbs, one step per limb; returns the carry out
+    template<size_t... I>
+    static constexpr limb_t addLimbs(limb_t *r, const limb_t *a, const limb_t *b, std::index_sequence<I...>) {
+        limb_t carry = 0;
+        ((carry = addStep(r[I], a[I], b[I], carry)), ...);
+        return carry;
+    }
+
+    static constexpr limb_t addStep(limb_t &r, limb_t a, limb_t b, limb_t carry) {
+        dlimb_t sum = static_cast<dlimb_t>(a) + b + carry;
+        r = static_cast<limb_t>(sum);
+        return static_cast<limb_t>(sum >> 64);
+    }
+
+    // r = a - b over all the limbs; returns the borrow out
+    template<size_t... I>
+    static constexpr limb_t subLimbs(limb_t *r, const limb_t *a, const limb_t *b, std::index_sequence<I...>) {
+        limb_t borrow = 0;
+        ((borrow = subStep(r[I], a[I], b[I], borrow)), ...);
+        return borrow;
+    }
+
+    static constexpr limb_t subStep(limb_t &r, limb_t a, limb_t b, limb_t borrow) {
+        dlimb_t difference = static_cast<dlimb_t>(a) - b - borrow;
+        r = static_cast<limb_t>(difference);
+        return static_cast<limb_t>(difference >> 64) & 1;
+    }
+
+    // r[k] += a[k] bi + carry for the k of one row; returns the carry out
+    template<size_t... J>
+    static constexpr limb_t mulRow(limb_t *r, const limb_t *a, limb_t bi, std::index_sequence<J...>) {
+        limb_t carry = 0;
+        ((carry = mulStep(r[J], a[J], bi, carry)), ...);
+        return carry;
+    }
+
+    static constexpr limb_t mulStep(limb_t &r, limb_t a, limb_t b, limb_t carry) {
+        dlimb_t t = static_cast<dlimb_t>(a) * b + r + carry;
+        r = static_cast<limb_t>(t);
+        return static_cast<limb_t>(t >> 64);
+    }
+
+    // r = a b mod 2^Bits: row i only reaches the limbs below LIMBS
+    template<size_t... I>
+    static constexpr void mulLow(limb_t *r, const limb_t *a, const limb_t *b, std::index_sequence<I...>) {
+        (static_cast<void>(mulRow(r + I, a, b[I], std::make_index_sequence<LIMBS - I>())), ...);
+    }
+
+    // r[0..2 LIMBS) = a b, r zero to start with
+    template<size_t... I>
+    static constexpr void mulFull(limb_t *r, const limb_t *a, const limb_t *b, std::index_sequence<I...>) {
+        ((r[I + LIMBS] = mulRow(r + I, a, b[I], Indices())), ...);
+    }
+
+    // a = a radix + digit; returns the limb carried out
+    static constexpr limb_t mulAdd1(limb_t *a, limb_t radix, limb_t digit) {
+        limb_t carry = digit;
+        for (size_t i = 0; i < LIMBS; ++i) {
+            dlimb_t t = static_cast<dlimb_t>(a[i]) * radix + carry;
+            a[i] = static_cast<limb_t>(t);
+            carry = static_cast<limb_t>(t >> 64);
+        }
+        return carry;
+    }
+
+    static constexpr size_t normalizedSize(const limb_t *a) {
+        size_t n = LIMBS;
+        while (n > 0 && a[n - 1] == 0) --n;
+        return n;
+    }
+
+    // Truncating division with the remainder taking the sign of a, by
+    // Knuth's algorithm D on the magnitudes
+    static constexpr void divide(const FixedInteger &a, const FixedInteger &b, FixedInteger &quotient,
+                                 FixedInteger &remainder) {
+        FixedInteger u = magnitude(a), v = magnitude(b);
+        size_t n = normalizedSize(v.limbs), m = normalizedSize(u.limbs);
+        if (n == 0) throw std::runtime_error("Division by zero");
+        quotient = FixedInteger();
+        remainder = FixedInteger();
+        if (compareMagnitudes(u.limbs, v.limbs) < 0) {
+            remainder = u;
+        } else if (n == 1) {
+            limb_t rest = 0;
+            for (size_t i = m; i-- > 0;) {
+                dlimb_t t = (static_cast<dlimb_t>(rest) << 64) | u.limbs[i];
+                quotient.limbs[i] = static_cast<limb_t>(t / v.limbs[0]);
+                rest = static_cast<limb_t>(t % v.limbs[0]);
+            }
+            remainder.limbs[0] = rest;
+        } else {
+            // Normalize so the divisor's top limb has its high bit set
+            auto shift = static_cast<unsigned>(__builtin_clzll(v.limbs[n - 1]));
+            limb_t vn[LIMBS] = {}, un[LIMBS + 1] = {};
+            for (size_t i = n; i-- > 0;) {
+                vn[i] = v.limbs[i] << shift;
+                if (shift && i > 0) vn[i] |= v.limbs[i - 1] >> (64 - shift);
+            }
+            un[m] = shift ? u.limbs[m - 1] >> (64 - shift) : 0;
+            for (size_t i = m; i-- > 0;) {
+                un[i] = u.limbs[i] << shift;
+                if (shift && i > 0) un[i] |= u.limbs[i - 1] >> (64 - shift);
+            }
+            for (size_t j = m - n + 1; j-- > 0;) {
+                dlimb_t top = (static_cast<dlimb_t>(un[j + n]) << 64) | un[j + n - 1];
+                dlimb_t qhat = top / vn[n - 1], rhat = top % vn[n - 1];
+                while (qhat >> 64 || qhat * vn[n - 2] > ((rhat << 64) | un[j + n - 2])) {
+                    --qhat;
+                    rhat += vn[n - 1];
+                    if (rhat >> 64) break;
+                }
+                // un[j..j+n] -= qhat vn
+                limb_t borrow = 0, carry = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    dlimb_t p = qhat * vn[i] + carry;
+                    carry = static_cast<limb_t>(p >> 64);
+                    borrow = subStep(un[i + j], un[i + j], static_cast<limb_t>(p), borrow);
+                }
+                borrow = subStep(un[j + n], un[j + n], carry, borrow);
+                if (borrow) {
+                    // qhat was one too large: add vn back
+                    --qhat;
+                    limb_t c = 0;
+                    for (size_t i = 0; i < n; ++i) c = addStep(un[i + j], un[i + j], vn[i], c);
+                    un[j + n] += c;
+                }
+                quotient.limbs[j] = static_cast<limb_t>(qhat);
+            }
+            for (size_t i = 0; i < n; ++i) {
+                remainder.limbs[i] = un[i] >> shift;
+                if (shift) remainder.limbs[i] |= un[i + 1] << (64 - shift);
+            }
+        }
+        bool negativeQuotient = a.isNegative() != b.isNegative();
+        if constexpr (Policy == OverflowPolicy::Checked) {
+            // Only min() / -1 leaves the range
+            if (Signed && !negativeQuotient && quotient.isNegative()) overflow();
+        }
+        if (negativeQuotient) quotient = negated(quotient);
+        if (a.isNegative()) remainder = negated(remainder);
+    }
+};
+
+#endif //BIGINTEGER_FIXEDINTEGER_H
@@ -0,0 +1,92 @@
+#include "Formatting.h"
+
+#include <cctype>
+#include <climits>
+#include <locale>
+#include <ostream>
+#include <string>
+
+namespace {
+    // Room toChars() needs for x in radix; the binary digits bound the others
+    size_t charsBound(const BigInteger &x, unsigned radix) {
+        return radix == 10 ? x.decimalSizeUpperBound() : 2 + x.bitLength();
+    }
+
+    // grouping holds the locale's group sizes the spec views
+    FormatSpec streamSpec(std::ostream &out, std::string &grouping) {
+        FormatSpec spec;
+        std::ios::fmtflags flags = out.flags();
+        std::ios::fmtflags base = flags & std::ios::basefield, adjust = flags & std::ios::adjustfield;
+        spec.radix = base == std::ios::hex ? 16 : base == std::ios::oct ? 8 : 10;
+        spec.uppercase = (flags & std::ios::uppercase) != 0;
+        spec.alternate = (flags & std::ios::showbase) != 0;
+        spec.streamBase = true;
+        // Like num_put, showpos marks only decimal output
+        if ((flags & std::ios::showpos) && spec.radix == 10) spec.sign = '+';
+        spec.width = out.width() > 0 ? static_cast<size_t>(out.width()) : 0;
+        spec.fill = out.fill();
+        spec.align = adjust == std::ios::left ? FormatSpec::Align::Left
+                     : adjust == std::ios::internal ? FormatSpec::Align::Internal : FormatSpec::Align::Right;
+        const auto &punctuation = std::use_facet<std::numpunct<char>>(out.getloc());
+        grouping = punctuation.grouping();
+        if (!grouping.empty() && grouping[0] > 0 && grouping[0] < CHAR_MAX) {
+            spec.groupSeparator = punctuation.thousands_sep();
+            spec.grouping = grouping;
+        }
+        return spec;
+    }
+
+    template<typename T>
+    std::ostream &print(std::ostream &out, const T &x) {
+        std::ostream::sentry sentry(out);
+        if (!sentry) return out;
+        std::string grouping;
+        FormattedInteger text(x, streamSpec(out, grouping));
+        std::streambuf *buffer = out.rdbuf();
+        bool failed = false;
+        text.emit([&](const char *chars, size_t size) {
+            auto count = static_cast<std::streamsize>(size);
+            if (!failed && buffer->sputn(chars, count) != count) failed = true;
+        });
+        out.width(0);
+        if (failed) out.setstate(std::ios::badbit);
+        return out;
+    }
+}
+
+FormattedInteger::FormattedInteger(const BigInteger &x, const FormatSpec &spec) : spec(spec) {
+    size_t size = charsBound(x, spec.radix);
+    char *first = buffer(size);
+    setDigits(first, x.toChars(first, first + size, spec.radix).ptr);
+}
+
+FormattedInteger::FormattedInteger(const Integer &x, const FormatSpec &spec) : spec(spec) {
+    // A long long takes at most a sign and 64 binary digits
+    size_t size = x.usingBigInteger() ? charsBound(x.asBigInteger(), spec.radix) : 65;
+    char *first = buffer(size);
+    setDigits(first, x.toChars(first, first + size, spec.radix).ptr);
+}
+
+char *FormattedInteger::buffer(size_t size) {
+    if (size <= LOCAL_SIZE) return local;
+    heap.reset(new char[size]);
+    return heap.get();
+}
+
+void FormattedInteger::setDigits(char *first, char *end) {
+    negative = *first == '-';
+    if (negative) ++first;
+    if (spec.uppercase) {
+        std::transform(first, end, first, [](char c) { return static_cast<char>(std::toupper(c)); });
+    }
+    digits = first;
+    length = static_cast<size_t>(end - first);
+}
+
+std::ostream &operator<<(std::ostream &out, const BigInteger &x) {
+    return print(out, x);
+}
+
+std::ostream &operator<<(std::ostream &out, const Integer &x) {
+    return print(out, x);
+}
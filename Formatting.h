@@ -0,0 +1,256 @@
+#ifndef BIGINTEGER_FORMATTING_H
+#define BIGINTEGER_FORMATTING_H
+
+#include "BigInteger.h"
+#include "Integer.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+
+#if __has_include(<format>)
+#include <format>
+#endif
+
+// Layout of a formatted integer. std::formatter reads it from a format spec
+// and operator<< from the stream's flags.
+struct FormatSpec {
+    enum class Align { Default, Left, Right, Center, Internal };
+
+    char fill = ' ';
+    Align align = Align::Default;
+    // '-' marks negative values only, '+' all of them, ' ' puts a space
+    // before the non-negative ones
+    char sign = '-';
+    // Prefix 0b, 0 or 0x
+    bool alternate = false;
+    // Give alternate iostream's showbase meaning instead: zero gets no
+    // prefix, and the octal 0 is a digit that internal padding goes before
+    bool streamBase = false;
+    // Pad with zeros between the sign and the digits, unless aligned
+    bool zeroPad = false;
+    size_t width = 0;
+    unsigned radix = 10;
+    bool uppercase = false;
+    // Put between groups of groupSize digits counted from the right, none if 0
+    char groupSeparator = 0;
+    size_t groupSize = 3;
+    // Group sizes as std::numpunct::grouping() gives them, rightmost first
+    // and the last repeating, in place of groupSize when not empty. The
+    // text it views must outlive the spec's use.
+    std::string_view grouping;
+};
+
+// Reads the spec of a std::format replacement field for an integer from
+// [first, last), stopping at its closing '}':
+//
+//   [[fill]align][sign][#][0][width][grouping][type]
+//
+// align is one of < > ^, sign one of + - and a space, grouping ',' for
+// groups of three digits or '_' for groups of three decimal or four other
+// digits, and type one of d b B o x X. Throws std::runtime_error for
+// anything else. Works in constant expressions, so std::format can check
+// its format strings at compile time.
+template<typename Iterator>
+constexpr Iterator parseFormatSpec(Iterator first, Iterator last, FormatSpec &spec) {
+    auto alignment = [](char c) {
+        switch (c) {
+            case '<':
+                return FormatSpec::Align::Left;
+            case '>':
+                return FormatSpec::Align::Right;
+            case '^':
+                return FormatSpec::Align::Center;
+            default:
+                return FormatSpec::Align::Default;
+        }
+    };
+    auto at = [&](Iterator it) { return it != last ? *it : '}'; };
+
+    Iterator next = first;
+    if (first != last) ++next;
+    if (at(first) != '{' && at(first) != '}' && alignment(at(next)) != FormatSpec::Align::Default) {
+        spec.fill = *first;
+        spec.align = alignment(*next);
+        first = ++next;
+    } else if (alignment(at(first)) != FormatSpec::Align::Default) {
+        spec.align = alignment(*first++);
+    }
+    if (at(first) == '+' || at(first) == '-' || at(first) == ' ') spec.sign = *first++;
+    if (at(first) == '#') {
+        spec.alternate = true;
+        ++first;
+    }
+    if (at(first) == '0') {
+        spec.zeroPad = true;
+        ++first;
+    }
+    for (; at(first) >= '0' && at(first) <= '9'; ++first) spec.width = spec.width * 10 + (*first - '0');
+    char grouping = 0;
+    if (at(first) == ',' || at(first) == '_') grouping = *first++;
+    switch (at(first)) {
+        case 'd':
+            ++first;
+            break;
+        case 'B':
+            spec.uppercase = true;
+            [[fallthrough]];
+        case 'b':
+            spec.radix = 2;
+            ++first;
+            break;
+        case 'o':
+            spec.radix = 8;
+            ++first;
+            break;
+        case 'X':
+            spec.uppercase = true;
+            [[fallthrough]];
+        case 'x':
+            spec.radix = 16;
+            ++first;
+            break;
+        default:
+            break;
+    }
+    if (at(first) != '}') throw std::runtime_error("Invalid format spec for an integer");
+    if (grouping) {
+        spec.groupSeparator = grouping;
+        spec.groupSize = grouping == '_' && spec.radix != 10 ? 4 : 3;
+    }
+    return first;
+}
+
+// The digits of one value laid out by a FormatSpec. They are kept on the
+// stack unless they are long, so formatting ordinary values allocates
+// nothing.
+class FormattedInteger {
+public:
+    FormattedInteger(const BigInteger &x, const FormatSpec &spec);
+
+    FormattedInteger(const Integer &x, const FormatSpec &spec);
+
+    FormattedInteger(const FormattedInteger &) = delete;
+
+    FormattedInteger &operator=(const FormattedInteger &) = delete;
+
+    // Passes the output to write(const char *, size_t) in pieces
+    template<typename Write>
+    void emit(Write &&write) const {
+        char prefix[4];
+        size_t prefixLength = 0;
+        if (negative) prefix[prefixLength++] = '-';
+        else if (spec.sign != '-') prefix[prefixLength++] = spec.sign;
+        // Zero in octal is "0" with or without the prefix
+        bool zero = length == 1 && digits[0] == '0', octalDigit = false;
+        if (spec.alternate && spec.radix != 10 && !(zero && (spec.radix == 8 || spec.streamBase))) {
+            if (spec.radix == 8 && spec.streamBase) {
+                octalDigit = true;
+            } else {
+                prefix[prefixLength++] = '0';
+                if (spec.radix == 2) prefix[prefixLength++] = spec.uppercase ? 'B' : 'b';
+                if (spec.radix == 16) prefix[prefixLength++] = spec.uppercase ? 'X' : 'x';
+            }
+        }
+        // Digits left of the first separator
+        size_t separators = 0, leading = length;
+        if (spec.groupSeparator) {
+            for (size_t size; (size = group(separators)) != 0 && leading > size; ++separators) leading -= size;
+        }
+        size_t total = prefixLength + octalDigit + length + separators;
+        size_t padding = spec.width > total ? spec.width - total : 0;
+
+        FormatSpec::Align align = spec.align;
+        char fill = spec.fill;
+        if (align == FormatSpec::Align::Default) {
+            align = spec.zeroPad ? FormatSpec::Align::Internal : FormatSpec::Align::Right;
+            if (spec.zeroPad) fill = '0';
+        }
+        size_t before = align == FormatSpec::Align::Right ? padding
+                        : align == FormatSpec::Align::Center ? padding / 2 : 0;
+        size_t inside = align == FormatSpec::Align::Internal ? padding : 0;
+
+        pad(write, fill, before);
+        write(prefix, prefixLength);
+        pad(write, fill, inside);
+        if (octalDigit) write("0", 1);
+        write(digits, leading);
+        const char *it = digits + leading;
+        for (size_t j = separators; j-- > 0; it += group(j)) {
+            write(&spec.groupSeparator, 1);
+            write(it, group(j));
+        }
+        pad(write, fill, padding - before - inside);
+    }
+
+private:
+    static constexpr size_t LOCAL_SIZE = 128;
+
+    FormatSpec spec;
+    char local[LOCAL_SIZE];
+    std::unique_ptr<char[]> heap;
+    // The magnitude's digits
+    const char *digits;
+    size_t length;
+    bool negative;
+
+    // Room for size chars
+    char *buffer(size_t size);
+
+    // Digits in group j, counted from the right; 0 once grouping stops
+    size_t group(size_t j) const {
+        if (spec.grouping.empty()) return spec.groupSize;
+        char size = spec.grouping[std::min(j, spec.grouping.size() - 1)];
+        return size > 0 && size < CHAR_MAX ? static_cast<size_t>(size) : 0;
+    }
+
+    // Takes the text toChars() left in [first, end)
+    void setDigits(char *first, char *end);
+
+    template<typename Write>
+    static void pad(Write &write, char fill, size_t count) {
+        char run[32];
+        std::fill(std::begin(run), std::end(run), fill);
+        for (; count > 0; count -= std::min(count, sizeof(run))) write(run, std::min(count, sizeof(run)));
+    }
+};
+
+#ifdef __cpp_lib_format
+
+template<typename T>
+struct IntegerFormatter {
+    FormatSpec spec;
+
+    constexpr auto parse(std::format_parse_context &context) {
+        try {
+            return parseFormatSpec(context.begin(), context.end(), spec);
+        } catch (const std::runtime_error &error) {
+            throw std::format_error(error.what());
+        }
+    }
+
+    template<typename Context>
+    auto format(const T &x, Context &context) const {
+        auto out = context.out();
+        FormattedInteger(x, spec).emit([&](const char *text, size_t size) { out = std::copy(text, text + size, out); });
+        return out;
+    }
+};
+
+namespace std {
+    template<>
+    struct formatter<BigInteger, char> : IntegerFormatter<BigInteger> {
+    };
+
+    template<>
+    struct formatter<Integer, char> : IntegerFormatter<Integer> {
+    };
+}
+
+#endif
+
+#endif //BIGINTEGER_FORMATTING_H
@@ -0,0 +1,206 @@
+#include "Instrumentation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace instrumentation {
+
+namespace {
+    const char *const OPERATION_NAMES[OPERATIONS] = {
+            "add", "subtract", "multiply", "divide", "modulo", "shift_left", "shift_right", "compare", "parse",
+            "to_string"
+    };
+
+    const char *const ALGORITHM_NAMES[ALGORITHMS] = {
+            "multiply_basecase", "multiply_karatsuba", "multiply_toom3", "multiply_toom4", "multiply_fft",
+            "multiply_unbalanced", "square_basecase", "square_karatsuba", "square_toom3", "square_toom4",
+            "square_fft", "divide_one_limb", "divide_schoolbook", "divide_divide_and_conquer"
+    };
+
+    template<size_t N>
+    void appendArray(std::string &out, const std::array<uint64_t, N> &values) {
+        out += '[';
+        for (size_t i = 0; i < N; ++i) {
+            if (i) out += ", ";
+            out += std::to_string(values[i]);
+        }
+        out += ']';
+    }
+
+    void appendField(std::string &out, const char *key, uint64_t value) {
+        out += ", \"";
+        out += key;
+        out += "\": ";
+        out += std::to_string(value);
+    }
+}
+
+const char *name(Operation operation) {
+    return OPERATION_NAMES[static_cast<size_t>(operation)];
+}
+
+const char *name(Algorithm algorithm) {
+    return ALGORITHM_NAMES[static_cast<size_t>(algorithm)];
+}
+
+std::string Snapshot::toJson() const {
+    std::string out = "{\"operations\": {";
+    for (size_t i = 0; i < OPERATIONS; ++i) {
+        if (i) out += ", ";
+        out += '"';
+        out += OPERATION_NAMES[i];
+        out += "\": {\"calls\": " + std::to_string(calls[i]) + ", \"nanoseconds\": " + std::to_string(nanoseconds[i]);
+        out += ", \"size_buckets\": ";
+        appendArray(out, sizes[i]);
+        out += '}';
+    }
+    out += "}, \"algorithms\": {";
+    for (size_t i = 0; i < ALGORITHMS; ++i) {
+        if (i) out += ", ";
+        out += '"';
+        out += ALGORITHM_NAMES[i];
+        out += "\": " + std::to_string(algorithms[i]);
+    }
+    out += '}';
+    appendField(out, "promotions", promotions);
+    appendField(out, "demotions", demotions);
+    appendField(out, "allocations", allocations);
+    appendField(out, "allocated_bytes", allocatedBytes);
+    appendField(out, "scratch_allocations", scratchAllocations);
+    appendField(out, "scratch_bytes", scratchBytes);
+    out += '}';
+    return out;
+}
+
+#ifdef BIGINTEGER_INSTRUMENTATION
+
+namespace {
+    using Counter = std::atomic<uint64_t>;
+
+    // Written only by the thread that owns it, so a plain load and store
+    // suffice; the atomics just let snapshot() read them meanwhile
+    struct Counters {
+        Counter calls[OPERATIONS]{};
+        Counter nanoseconds[OPERATIONS]{};
+        Counter sizes[OPERATIONS][SIZE_BUCKETS]{};
+        Counter algorithms[ALGORITHMS]{};
+        Counter promotions{0};
+        Counter demotions{0};
+        Counter allocations{0};
+        Counter allocatedBytes{0};
+        Counter scratchAllocations{0};
+        Counter scratchBytes{0};
+
+        void addTo(Snapshot &total) const {
+            auto read = [](const Counter &counter) { return counter.load(std::memory_order_relaxed); };
+            for (size_t i = 0; i < OPERATIONS; ++i) {
+                total.calls[i] += read(calls[i]);
+                total.nanoseconds[i] += read(nanoseconds[i]);
+                for (size_t k = 0; k < SIZE_BUCKETS; ++k) total.sizes[i][k] += read(sizes[i][k]);
+            }
+            for (size_t i = 0; i < ALGORITHMS; ++i) total.algorithms[i] += read(algorithms[i]);
+            total.promotions += read(promotions);
+            total.demotions += read(demotions);
+            total.allocations += read(allocations);
+            total.allocatedBytes += read(allocatedBytes);
+            total.scratchAllocations += read(scratchAllocations);
+            total.scratchBytes += read(scratchBytes);
+        }
+    };
+
+    void bump(Counter &counter, uint64_t amount = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<const Counters *> live;
+        // What threads that have exited counted
+        Snapshot retired;
+    };
+
+    // Never destroyed, as threads may still exit after static destruction
+    Registry &registry() {
+        static auto *instance = new Registry;
+        return *instance;
+    }
+
+    struct ThreadCounters {
+        Counters counters;
+
+        ThreadCounters() {
+            Registry &r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.live.push_back(&counters);
+        }
+
+        ~ThreadCounters() {
+            Registry &r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            counters.addTo(r.retired);
+            r.live.erase(std::find(r.live.begin(), r.live.end(), &counters));
+        }
+    };
+
+    Counters &local() {
+        thread_local ThreadCounters instance;
+        return instance.counters;
+    }
+
+    size_t sizeBucket(size_t limbs) {
+        size_t width = limbs == 0 ? 0 : 64 - static_cast<size_t>(__builtin_clzll(limbs));
+        return std::min(width, SIZE_BUCKETS - 1);
+    }
+}
+
+Snapshot snapshot() {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    Snapshot total = r.retired;
+    for (const Counters *counters: r.live) counters->addTo(total);
+    return total;
+}
+
+void recordOperation(Operation operation, size_t limbs, uint64_t nanoseconds) {
+    Counters &counters = local();
+    auto i = static_cast<size_t>(operation);
+    bump(counters.calls[i]);
+    bump(counters.nanoseconds[i], nanoseconds);
+    bump(counters.sizes[i][sizeBucket(limbs)]);
+}
+
+void recordAlgorithm(Algorithm algorithm) {
+    bump(local().algorithms[static_cast<size_t>(algorithm)]);
+}
+
+void recordPromotion() {
+    bump(local().promotions);
+}
+
+void recordDemotion() {
+    bump(local().demotions);
+}
+
+void recordAllocation(size_t bytes) {
+    Counters &counters = local();
+    bump(counters.allocations);
+    bump(counters.allocatedBytes, bytes);
+}
+
+void recordScratchAllocation(size_t bytes) {
+    Counters &counters = local();
+    bump(counters.scratchAllocations);
+    bump(counters.scratchBytes, bytes);
+}
+
+#else
+
+Snapshot snapshot() {
+    return {};
+}
+
+#endif
+
+}
@@ -0,0 +1,127 @@
+#ifndef BIGINTEGER_INSTRUMENTATION_H
+#define BIGINTEGER_INSTRUMENTATION_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Opt-in counters of what the library does: calls, operand sizes and time
+// per operator, the multiplication and division algorithms dispatched,
+// Integer promotions and demotions, and heap allocations. They are compiled
+// in only when BIGINTEGER_INSTRUMENTATION is defined (the CMake option of
+// that name); otherwise the recording functions below are empty and
+// snapshot() returns zeros. Every thread counts into its own block, which
+// only it writes, and snapshot() adds the blocks up.
+namespace instrumentation {
+    enum class Operation {
+        Add, Subtract, Multiply, Divide, Modulo, ShiftLeft, ShiftRight, Compare, Parse, ToString
+    };
+
+    constexpr size_t OPERATIONS = static_cast<size_t>(Operation::ToString) + 1;
+
+    // Multiplications are counted where limbs::mul(), mul_n() and sqr()
+    // pick an algorithm, divisions where limbs::divrem() does; the calls
+    // made inside other algorithms (division by products, for one) count
+    // too, the recursive steps of an algorithm do not
+    enum class Algorithm {
+        MultiplyBasecase, MultiplyKaratsuba, MultiplyToom3, MultiplyToom4, MultiplyFFT, MultiplyUnbalanced,
+        SquareBasecase, SquareKaratsuba, SquareToom3, SquareToom4, SquareFFT,
+        DivideOneLimb, DivideSchoolbook, DivideDivideAndConquer
+    };
+
+    constexpr size_t ALGORITHMS = static_cast<size_t>(Algorithm::DivideDivideAndConquer) + 1;
+
+    // Operand sizes are histogrammed by bit width: bucket k counts calls
+    // whose larger operand had 2^(k-1) <= limbs < 2^k limbs
+    constexpr size_t SIZE_BUCKETS = 40;
+
+    const char *name(Operation operation);
+
+    const char *name(Algorithm algorithm);
+
+    // Totals since the start of the process; the counters only grow, so the
+    // activity over an interval is the difference of two snapshots
+    struct Snapshot {
+        std::array<uint64_t, OPERATIONS> calls{};
+        std::array<uint64_t, OPERATIONS> nanoseconds{};
+        std::array<std::array<uint64_t, SIZE_BUCKETS>, OPERATIONS> sizes{};
+        std::array<uint64_t, ALGORITHMS> algorithms{};
+        // Integer switching to and from its BigInteger representation
+        uint64_t promotions = 0;
+        uint64_t demotions = 0;
+        // Heap blocks taken for BigInteger limbs
+        uint64_t allocations = 0;
+        uint64_t allocatedBytes = 0;
+        // Blocks the per-thread scratch pools took from the heap
+        uint64_t scratchAllocations = 0;
+        uint64_t scratchBytes = 0;
+
+        // One JSON object, operations and algorithms keyed by name()
+        [[nodiscard]] std::string toJson() const;
+    };
+
+    constexpr bool enabled() {
+#ifdef BIGINTEGER_INSTRUMENTATION
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // The counters of all threads, those that have exited included
+    Snapshot snapshot();
+
+#ifdef BIGINTEGER_INSTRUMENTATION
+    void recordOperation(Operation operation, size_t limbs, uint64_t nanoseconds);
+
+    void recordAlgorithm(Algorithm algorithm);
+
+    void recordPromotion();
+
+    void recordDemotion();
+
+    void recordAllocation(size_t bytes);
+
+    void recordScratchAllocation(size_t bytes);
+
+    // Counts one operation on operands of up to limbs limbs, timed over its own lifetime
+    class ScopedOperation {
+    public:
+        ScopedOperation(Operation operation, size_t limbs)
+                : operation(operation), limbs(limbs), start(std::chrono::steady_clock::now()) {}
+
+        ScopedOperation(const ScopedOperation &) = delete;
+
+        ScopedOperation &operator=(const ScopedOperation &) = delete;
+
+        ~ScopedOperation() {
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+            recordOperation(operation, limbs, static_cast<uint64_t>(elapsed.count()));
+        }
+
+    private:
+        Operation operation;
+        size_t limbs;
+        std::chrono::steady_clock::time_point start;
+    };
+#else
+    inline void recordAlgorithm(Algorithm) {}
+
+    inline void recordPromotion() {}
+
+    inline void recordDemotion() {}
+
+    inline void recordAllocation(size_t) {}
+
+    inline void recordScratchAllocation(size_t) {}
+
+    class ScopedOperation {
+    public:
+        ScopedOperation(Operation, size_t) {}
+    };
+#endif
+}
+
+#endif //BIGINTEGER_INSTRUMENTATION_H
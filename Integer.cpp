@@ -3,12 +3,13 @@
 //
 
 #include "Integer.h"
+#include "Instrumentation.h"
 
 const BigInteger &Integer::asBigInteger() const {
     if (!useBigInt) {
-        throw std::runtime_error("Integer is using BigInteger");
+        throw std::runtime_error("Integer is using long long");
     }
-    return bigIntegerValue;
+    return *bigIntegerValue;
 }
 
 long long Integer::asLongLong() const {
@@ -18,276 +19,176 @@ long long Integer::asLongLong() const {
     return intValue;
 }
 
-Integer &Integer::operator++() {
-    if (!useBigInt) {
-        if (intValue == std::numeric_limits<long long>::max()) {
-            changeToBigInt();
-        } else {
-            ++intValue;
-            return *this;
-        }
-    }
-    ++bigIntegerValue;
-    return *this;
-}
-
-
-Integer &Integer::operator--() {
-    if (!useBigInt) {
-        if (intValue == std::numeric_limits<long long>::min()) {
-            changeToBigInt();
-        } else {
-            --intValue;
-            return *this;
-        }
-    }
-    --bigIntegerValue;
-    return *this;
-}
-
-Integer Integer::operator++(int) {
-    Integer oldValue(*this); // Make a copy of the current object
-    ++*this;                 // Increment the value
-    return oldValue;         // Return the old value (before decrement
-}
-
-Integer Integer::operator--(int) {
-    Integer oldValue(*this); // Make a copy of the current object
-    --*this;                 // Decrement the value
-    return oldValue;         // Return the old value (before decrement
-}
-
-bool Integer::operator<(const Integer &h) const {
-    if (useBigInt) {
-        if (h.useBigInt) return bigIntegerValue < h.bigIntegerValue;
-        else return BigInteger(intValue) < h.bigIntegerValue;
-    } else {
-        if (h.useBigInt) return bigIntegerValue < BigInteger(h.intValue);
-        else return intValue < h.intValue;
+int Integer::compare(const Integer &h) const {
+    if (useBigInt && h.useBigInt) {
+        if (*bigIntegerValue < *h.bigIntegerValue) return -1;
+        return *bigIntegerValue == *h.bigIntegerValue ? 0 : 1;
     }
+    // A BigInteger is always outside the long long range, so its sign decides
+    if (useBigInt) return *bigIntegerValue < BigInteger::ZERO() ? -1 : 1;
+    if (h.useBigInt) return *h.bigIntegerValue < BigInteger::ZERO() ? 1 : -1;
+    return intValue < h.intValue ? -1 : (intValue == h.intValue ? 0 : 1);
 }
 
-bool Integer::operator<=(const Integer &h) const {
-    if (*this == h) return true;
-    return *this < h;
-}
-
-bool Integer::operator>(const Integer &h) const {
-    if (useBigInt) {
-        if (h.useBigInt) return bigIntegerValue > h.bigIntegerValue;
-        else return BigInteger(intValue) > h.bigIntegerValue;
-    } else {
-        if (h.useBigInt) return bigIntegerValue > BigInteger(h.intValue);
-        else return intValue > h.intValue;
-    }
-}
-
-bool Integer::operator>=(const Integer &h) const {
-    if (*this == h) return true;
-    return *this > h;
-}
-
-bool Integer::operator==(const Integer &h) const {
-    if (useBigInt) {
-        if (h.useBigInt) return h.bigIntegerValue == bigIntegerValue;
-        else return BigInteger(h.intValue) == bigIntegerValue;
-    } else {
-        if (h.useBigInt) return h.bigIntegerValue == BigInteger(intValue);
-        else return h.intValue == intValue;
-    }
-}
-
-bool Integer::operator!=(const Integer &h) const {
-    return !(*this == h); // Reuse the == operator
-}
-
-
-Integer Integer::operator+(const Integer &h) const {
-    Integer rtn(*this);
-    rtn += h;
-    return rtn;
-}
-
-Integer Integer::operator-(const Integer &h) const {
-    Integer rtn(*this);
-    rtn -= h;
-    return rtn;
-}
-
-Integer Integer::operator*(const Integer &h) const {
-    Integer rtn(*this);
-    rtn *= h;
-    return rtn;
-}
-
-Integer Integer::operator/(const Integer &h) const {
+Integer Integer::operator<<(const Integer &h) const {
     Integer rtn(*this);
-    rtn /= h;
+    rtn <<= h;
     return rtn;
 }
 
-Integer Integer::operator%(const Integer &h) const {
+Integer Integer::operator>>(const Integer &h) const {
     Integer rtn(*this);
-    rtn %= h;
+    rtn >>= h;
     return rtn;
 }
 
-Integer Integer::operator<<(const Integer &h) const {
+Integer Integer::operator<<(size_t h) const {
     Integer rtn(*this);
     rtn <<= h;
     return rtn;
 }
 
-Integer Integer::operator>>(const Integer &h) const {
+Integer Integer::operator>>(size_t h) const {
     Integer rtn(*this);
     rtn >>= h;
     return rtn;
 }
 
-Integer &Integer::operator+=(const Integer &h) {
-    if (usingBigInteger() || h.usingBigInteger()) {
-        if(usingBigInteger() && !h.usingBigInteger()) *this = Integer(asBigInteger() + h.asLongLong());
-        else if(!usingBigInteger() && h.usingBigInteger()) *this = Integer( h.asBigInteger() + asLongLong() );
-        else *this = Integer(asBigInteger() + h.asBigInteger());
+Integer &Integer::bigPlus(const Integer &h, bool subtract) {
+    if (!useBigInt) changeToBigInt();
+    // h may be *this, in which case it has just become a BigInteger too
+    if (h.useBigInt) {
+        if (subtract) *bigIntegerValue -= *h.bigIntegerValue;
+        else *bigIntegerValue += *h.bigIntegerValue;
     } else {
-        long long result;
-        if (addition_overflow(asLongLong(), h.asLongLong(), result)) {
-            *this = Integer(BigInteger(asLongLong()) + BigInteger(h.asLongLong()));
-        } else {
-            intValue = result;
-        }
+        if (subtract) *bigIntegerValue -= BigInteger(h.intValue);
+        else *bigIntegerValue += BigInteger(h.intValue);
     }
+    demote();
     return *this;
 }
 
-Integer &Integer::operator-=(const Integer &h) {
-    if (usingBigInteger() || h.usingBigInteger()) {
-        if(usingBigInteger() && !h.usingBigInteger()) *this = Integer(asBigInteger() - h.asLongLong());
-        else if(!usingBigInteger() && h.usingBigInteger()) *this = Integer( h.asBigInteger() - asLongLong() );
-        else *this = Integer(asBigInteger() - h.asBigInteger());
-    } else {
-        long long result;
-        if (addition_overflow(asLongLong(), -h.asLongLong(), result)) {
-            *this = Integer(BigInteger(asLongLong()) - BigInteger(h.asLongLong()));
-        } else {
-            intValue = result;
-        }
-    }
+Integer &Integer::bigMultiply(const Integer &h) {
+    if (!useBigInt) changeToBigInt();
+    if (h.useBigInt) *bigIntegerValue *= *h.bigIntegerValue;
+    else *bigIntegerValue *= BigInteger(h.intValue);
+    demote();
     return *this;
 }
 
-Integer &Integer::operator*=(const Integer &h) {
-    if (usingBigInteger() || h.usingBigInteger()) {
-        if(usingBigInteger() && !h.usingBigInteger()) *this = Integer(asBigInteger() * h.asLongLong());
-        else if(!usingBigInteger() && h.usingBigInteger()) *this = Integer( h.asBigInteger() * asLongLong() );
-        else *this = Integer(asBigInteger() * h.asBigInteger());
-    } else {
-        long long result;
-        if (multiplication_overflow(asLongLong(), h.asLongLong(), result)) {
-            *this = Integer(BigInteger(asLongLong()) * BigInteger(h.asLongLong()));
-        } else {
-            intValue = result;
-        }
-    }
+Integer &Integer::bigDivide(const Integer &h, bool remainder) {
+    if (!useBigInt) changeToBigInt();
+    BigInteger smallDivisor(h.useBigInt ? 0 : h.intValue);
+    const BigInteger &divisor = h.useBigInt ? *h.bigIntegerValue : smallDivisor;
+    if (remainder) *bigIntegerValue %= divisor;
+    else *bigIntegerValue /= divisor;
+    demote();
     return *this;
 }
 
-Integer &Integer::operator/=(const Integer &h) {
-    if (usingBigInteger() || h.usingBigInteger()) {
-        if(usingBigInteger() && !h.usingBigInteger()) *this = Integer(asBigInteger() / h.asLongLong());
-        else if(!usingBigInteger() && h.usingBigInteger()) *this = Integer( h.asBigInteger() / asLongLong() );
-        else *this = Integer(asBigInteger() / h.asBigInteger());
-    } else {
-        if (asLongLong() == std::numeric_limits<long long>::min() || h.asLongLong() == -1) {
-            *this = Integer(LONGMAX() + 1);
-        }else intValue /= h.asLongLong();
+Integer &Integer::operator<<=(const Integer &h) {
+    if (h < 0) throw std::runtime_error("Negative shift count");
+    if (h.useBigInt) {
+        if (*this != 0) throw std::runtime_error("Shift count too large");
+        return *this;
     }
-    return *this;
+    return *this <<= static_cast<size_t>(h.intValue);
 }
 
-Integer &Integer::operator%=(const Integer &h) {
-    if (usingBigInteger() || h.usingBigInteger()) {
-        if(usingBigInteger() && !h.usingBigInteger()) *this = Integer(asBigInteger() % h.asLongLong());
-        else if(!usingBigInteger() && h.usingBigInteger()) *this = Integer( h.asBigInteger() % asLongLong() );
-        else *this = Integer(asBigInteger() % h.asBigInteger());
-    } else {
-        intValue %= h.asLongLong();
-    }
-    return *this;
+Integer &Integer::operator>>=(const Integer &h) {
+    if (h < 0) throw std::runtime_error("Negative shift count");
+    // Any count past the long long range shifts every bit out
+    if (h.useBigInt) return *this >>= std::numeric_limits<size_t>::max();
+    return *this >>= static_cast<size_t>(h.intValue);
 }
 
-Integer &Integer::operator<<=(const Integer &h) {
-    for (Integer i = 0; i < h; ++i) {
-        (*this) *= 2;
+Integer &Integer::operator<<=(size_t h) {
+    if (!useBigInt) {
+        // clrsb counts the redundant sign bits, i.e. how far the value can move left and still fit
+        if (intValue == 0 || h <= static_cast<size_t>(__builtin_clrsbll(intValue))) {
+            intValue = static_cast<long long>(static_cast<unsigned long long>(intValue) << (h < 64 ? h : 0));
+            return *this;
+        }
+        changeToBigInt();
     }
+    *bigIntegerValue <<= h;
     return *this;
 }
 
-Integer &Integer::operator>>=(const Integer &h) {
-    for (Integer i = 0; i < h; ++i) {
-        (*this) /= 2;
+Integer &Integer::operator>>=(size_t h) {
+    if (!useBigInt) {
+        intValue = h < 64 ? intValue >> h : (intValue < 0 ? -1 : 0);
+        return *this;
     }
+    *bigIntegerValue >>= h;
+    demote();
     return *this;
 }
 
 void Integer::changeToBigInt() {
-    bigIntegerValue = BigInteger(intValue);
+    if (useBigInt) return;
+    instrumentation::recordPromotion();
+    bigIntegerValue = newBigInteger(intValue);
     useBigInt = true;
 }
 
-std::optional<long long> Integer::changeToLongLong() {
-    if (!useBigInt) return intValue;
-    if (bigIntegerValue > LONGMAX() || bigIntegerValue < LONGMIN()) {
-        return {};
-    }
-    useBigInt = false;
-    intValue = 0;
-    long long mul = 1;
-    for (int i = 0; i < bigIntegerValue.size(); ++i) {
-        intValue += bigIntegerValue[i] * mul;
-        mul *= 10;
+void Integer::assignBigInteger(const BigInteger &value) {
+    std::optional<long long> word = value.toLongLong();
+    if (word) {
+        if (useBigInt) instrumentation::recordDemotion();
+        *this = *word;
+    } else if (useBigInt) {
+        *bigIntegerValue = value;
+    } else {
+        instrumentation::recordPromotion();
+        bigIntegerValue = newBigInteger(value);
+        useBigInt = true;
     }
-    return intValue;
 }
 
-bool Integer::addition_overflow(long long a, long long b, long long &result) {
-    if ((b > 0) && (a > std::numeric_limits<long long>::max() - b)) {
-        return true;
-    }
-    if ((b < 0) && (a < std::numeric_limits<long long>::min() - b)) {
-        return true;
+void Integer::demote() {
+    if (!useBigInt) return;
+    std::optional<long long> word = bigIntegerValue->toLongLong();
+    if (word) {
+        instrumentation::recordDemotion();
+        *this = *word;
     }
-    result = a + b;
-    return false;
 }
 
-bool Integer::multiplication_overflow(long long a, long long b, long long &result) {
-    if (a > 0) {
-        if (b > 0) {
-            if (a > std::numeric_limits<long long>::max() / b) {
-                return true;
-            }
-        } else {
-            if (b < std::numeric_limits<long long>::min() / a) {
-                return true;
-            }
-        }
-    } else {
-        if (b > 0) {
-            if (a < std::numeric_limits<long long>::min() / b) {
-                return true;
-            }
-        } else {
-            if ((a != 0) && (b < std::numeric_limits<long long>::max() / a)) {
-                return true;
-            }
+Integer Integer::pow(uint64_t exponent) const {
+    if (!useBigInt) {
+        // Right to left; once the base no longer fits, neither does the result
+        long long result = 1, base = intValue;
+        bool overflow = false;
+        for (uint64_t e = exponent; e != 0 && !overflow;) {
+            if (e & 1) overflow = __builtin_mul_overflow(result, base, &result);
+            e >>= 1;
+            if (e != 0 && !overflow) overflow = __builtin_mul_overflow(base, base, &base);
         }
+        if (!overflow) return result;
     }
-    result = a * b;
-    return false;
+    return ::pow(useBigInt ? *bigIntegerValue : BigInteger(intValue), exponent);
+}
+
+std::optional<long long> Integer::changeToLongLong() {
+    if (!useBigInt) return intValue;
+    return {};
 }
 
 std::string Integer::toString() const {
     if(!useBigInt) return std::to_string(intValue);
-    return bigIntegerValue.toString();
+    return bigIntegerValue->toString();
+}
+
+size_t Integer::decimalSizeUpperBound() const {
+    // "-9223372036854775808"
+    return useBigInt ? bigIntegerValue->decimalSizeUpperBound() : 20;
+}
+
+std::to_chars_result Integer::toChars(char *first, char *last, unsigned radix) const {
+    if (useBigInt) return bigIntegerValue->toChars(first, last, radix);
+    // std::to_chars writes the same digits up to radix 32
+    bool powerOfTwo = radix >= 2 && (radix & (radix - 1)) == 0;
+    if (radix == 10 || (powerOfTwo && radix <= 32)) return std::to_chars(first, last, intValue, static_cast<int>(radix));
+    return BigInteger(intValue).toChars(first, last, radix);
 }
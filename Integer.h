@@ -10,7 +10,13 @@
 #include <limits>
 #include <type_traits>
 #include <optional>
+#include <new>
+#include <utility>
 
+// Holds a long long while the value fits in one and a heap BigInteger only
+// when it does not, so every value has exactly one representation. The
+// word-sized fast paths are inline; the BigInteger paths demote their result
+// back to a long long whenever it fits.
 class Integer {
 public:
     static BigInteger LONGMAX () {
@@ -24,19 +30,65 @@ public:
     }
 
     template<typename T, typename std::enable_if<std::is_integral<T>::value>::type * = nullptr>
-    Integer(T value = 0) : intValue(value), bigIntegerValue(), useBigInt(false) {}
+    Integer(T value = 0) : intValue(static_cast<long long>(value)), useBigInt(false) {
+        if constexpr (sizeof(T) > sizeof(long long) || (std::is_unsigned<T>::value && sizeof(T) == sizeof(long long))) {
+            bool fits;
+            if constexpr (std::is_signed<T>::value) {
+                fits = value >= std::numeric_limits<long long>::min() && value <= std::numeric_limits<long long>::max();
+            } else {
+                fits = value <= static_cast<unsigned long long>(std::numeric_limits<long long>::max());
+            }
+            if (!fits) {
+                bigIntegerValue = newBigInteger(value);
+                useBigInt = true;
+            }
+        }
+    }
+
+    Integer(const BigInteger &value) : intValue(0), useBigInt(false) { assignBigInteger(value); }
+
+    Integer(const Integer &other) : useBigInt(other.useBigInt) {
+        if (useBigInt) bigIntegerValue = newBigInteger(*other.bigIntegerValue);
+        else intValue = other.intValue;
+    }
+
+    Integer(Integer &&other) noexcept : useBigInt(other.useBigInt) {
+        if (useBigInt) bigIntegerValue = other.bigIntegerValue;
+        else intValue = other.intValue;
+        other.intValue = 0;
+        other.useBigInt = false;
+    }
+
+    Integer &operator=(const Integer &other) {
+        if (this == &other) return *this;
+        if (other.useBigInt) return *this = *other.bigIntegerValue;
+        return *this = other.intValue;
+    }
 
-    Integer(const BigInteger &value) : intValue(0), bigIntegerValue(value), useBigInt(true) {}
+    Integer &operator=(Integer &&other) noexcept {
+        if (this == &other) return *this;
+        if (useBigInt) deleteBigInteger(bigIntegerValue);
+        useBigInt = other.useBigInt;
+        if (useBigInt) bigIntegerValue = other.bigIntegerValue;
+        else intValue = other.intValue;
+        other.intValue = 0;
+        other.useBigInt = false;
+        return *this;
+    }
+
+    ~Integer() {
+        if (useBigInt) deleteBigInteger(bigIntegerValue);
+    }
 
     Integer &operator=(long long value) {
+        if (useBigInt) deleteBigInteger(bigIntegerValue);
         intValue = value;
         useBigInt = false;
         return *this;
     }
 
     Integer &operator=(const BigInteger &value) {
-        bigIntegerValue = value;
-        useBigInt = true;
+        assignBigInteger(value);
         return *this;
     }
 
@@ -45,69 +97,208 @@ public:
     [[nodiscard]] long long asLongLong() const;
 
     [[nodiscard]] const BigInteger &asBigInteger() const;
-    // Add other operators, e.g. +, -, *, /, etc., with overflow checking and BigInteger conversion
-    Integer &operator++();
 
-    Integer &operator--();
+    Integer &operator++() {
+        if (!useBigInt && intValue != std::numeric_limits<long long>::max()) ++intValue;
+        else bigPlus(1, false);
+        return *this;
+    }
+
+    Integer &operator--() {
+        if (!useBigInt && intValue != std::numeric_limits<long long>::min()) --intValue;
+        else bigPlus(1, true);
+        return *this;
+    }
 
-    Integer operator++(int);
+    Integer operator++(int) {
+        Integer oldValue(*this); // Make a copy of the current object
+        ++*this;                 // Increment the value
+        return oldValue;         // Return the old value (before increment)
+    }
 
-    Integer operator--(int);
+    Integer operator--(int) {
+        Integer oldValue(*this); // Make a copy of the current object
+        --*this;                 // Decrement the value
+        return oldValue;         // Return the old value (before decrement)
+    }
 
-    bool operator<(const Integer &h) const;
+    bool operator<(const Integer &h) const {
+        if (!useBigInt && !h.useBigInt) return intValue < h.intValue;
+        return compare(h) < 0;
+    }
 
-    bool operator>(const Integer &h) const;
+    bool operator>(const Integer &h) const {
+        if (!useBigInt && !h.useBigInt) return intValue > h.intValue;
+        return compare(h) > 0;
+    }
 
-    bool operator<=(const Integer &h) const;
+    bool operator<=(const Integer &h) const { return !(*this > h); }
 
-    bool operator>=(const Integer &h) const;
+    bool operator>=(const Integer &h) const { return !(*this < h); }
 
-    bool operator==(const Integer &h) const;
+    bool operator==(const Integer &h) const {
+        if (!useBigInt && !h.useBigInt) return intValue == h.intValue;
+        return compare(h) == 0;
+    }
 
-    bool operator!=(const Integer &h) const;
+    bool operator!=(const Integer &h) const { return !(*this == h); }
 
-    Integer operator+(const Integer &h) const;
+    Integer operator+(const Integer &h) const {
+        Integer rtn(*this);
+        rtn += h;
+        return rtn;
+    }
 
-    Integer operator-(const Integer &h) const;
+    Integer operator-(const Integer &h) const {
+        Integer rtn(*this);
+        rtn -= h;
+        return rtn;
+    }
 
-    Integer operator*(const Integer &h) const;
+    Integer operator*(const Integer &h) const {
+        Integer rtn(*this);
+        rtn *= h;
+        return rtn;
+    }
 
-    Integer operator/(const Integer &h) const;
+    Integer operator/(const Integer &h) const {
+        Integer rtn(*this);
+        rtn /= h;
+        return rtn;
+    }
 
-    Integer operator%(const Integer &h) const;
+    Integer operator%(const Integer &h) const {
+        Integer rtn(*this);
+        rtn %= h;
+        return rtn;
+    }
 
     Integer operator<<(const Integer &h) const;
 
     Integer operator>>(const Integer &h) const;
 
-    Integer &operator+=(const Integer &h);
+    Integer operator<<(size_t h) const;
+
+    Integer operator>>(size_t h) const;
 
-    Integer &operator-=(const Integer &h);
+    Integer &operator+=(const Integer &h) {
+        long long result;
+        if (useBigInt || h.useBigInt || __builtin_add_overflow(intValue, h.intValue, &result)) return bigPlus(h, false);
+        intValue = result;
+        return *this;
+    }
 
-    Integer &operator*=(const Integer &h);
+    Integer &operator-=(const Integer &h) {
+        long long result;
+        if (useBigInt || h.useBigInt || __builtin_sub_overflow(intValue, h.intValue, &result)) return bigPlus(h, true);
+        intValue = result;
+        return *this;
+    }
+
+    Integer &operator*=(const Integer &h) {
+        long long result;
+        if (useBigInt || h.useBigInt || __builtin_mul_overflow(intValue, h.intValue, &result)) return bigMultiply(h);
+        intValue = result;
+        return *this;
+    }
 
-    Integer &operator/=(const Integer &h);
+    Integer &operator/=(const Integer &h) {
+        // LLONG_MIN / -1 is the one quotient of two words that overflows
+        if (!useBigInt && !h.useBigInt && h.intValue != 0 && h.intValue != -1) {
+            intValue /= h.intValue;
+            return *this;
+        }
+        return bigDivide(h, false);
+    }
 
-    Integer &operator%=(const Integer &h);
+    Integer &operator%=(const Integer &h) {
+        if (!useBigInt && !h.useBigInt && h.intValue != 0) {
+            intValue = h.intValue == -1 ? 0 : intValue % h.intValue;
+            return *this;
+        }
+        return bigDivide(h, true);
+    }
 
     Integer &operator<<=(const Integer &h);
 
     Integer &operator>>=(const Integer &h);
 
+    Integer &operator<<=(size_t h);
+
+    // Arithmetic shift, rounding toward negative infinity
+    Integer &operator>>=(size_t h);
+
+    // *this^exponent, with 0^0 = 1. Stays in long long arithmetic until a
+    // step overflows.
+    [[nodiscard]] Integer pow(uint64_t exponent) const;
+
+    // Kept for compatibility: values are demoted automatically, so this only
+    // reports the long long when there is one
     std::optional<long long> changeToLongLong();
 
     [[nodiscard]] std::string toString() const;
 
-    static bool addition_overflow(long long a, long long b, long long& result);
-    static bool multiplication_overflow(long long a, long long b, long long& result);
+    // The same as BigInteger's, without a BigInteger for a long long
+    [[nodiscard]] size_t decimalSizeUpperBound() const;
+
+    std::to_chars_result toChars(char *first, char *last, unsigned radix = 10) const;
+
+    static bool addition_overflow(long long a, long long b, long long& result) {
+        return __builtin_add_overflow(a, b, &result);
+    }
+
+    static bool multiplication_overflow(long long a, long long b, long long& result) {
+        return __builtin_mul_overflow(a, b, &result);
+    }
 
 private:
-    long long intValue;
-    BigInteger bigIntegerValue;
+    union {
+        long long intValue;
+        BigInteger *bigIntegerValue;
+    };
     bool useBigInt;
 
+    // The BigInteger object comes from the same memory resource as its limbs,
+    // so a BigInteger::ResourceScope holds the whole value
+    template<typename... Args>
+    static BigInteger *newBigInteger(Args &&... args) {
+        std::pmr::memory_resource *resource = LimbVector::currentResource();
+        void *memory = resource->allocate(sizeof(BigInteger), alignof(BigInteger));
+        try {
+            return new(memory) BigInteger(std::forward<Args>(args)...);
+        } catch (...) {
+            resource->deallocate(memory, sizeof(BigInteger), alignof(BigInteger));
+            throw;
+        }
+    }
+
+    static void deleteBigInteger(BigInteger *value) {
+        std::pmr::memory_resource *resource = value->memoryResource();
+        value->~BigInteger();
+        resource->deallocate(value, sizeof(BigInteger), alignof(BigInteger));
+    }
+
     void changeToBigInt();
+
+    // Stores value, as a long long if it fits
+    void assignBigInteger(const BigInteger &value);
+
+    // Drops back to a long long if the BigInteger value fits in one
+    void demote();
+
+    // Three-way comparison for when at least one side is a BigInteger
+    [[nodiscard]] int compare(const Integer &h) const;
+
+    // Out-of-line paths for operands or results that need a BigInteger
+    Integer &bigPlus(const Integer &h, bool subtract);
+
+    Integer &bigMultiply(const Integer &h);
+
+    Integer &bigDivide(const Integer &h, bool remainder);
 };
 
 
+// Writes x like a BigInteger, see Formatting.h
+std::ostream &operator<<(std::ostream &out, const Integer &x);
+
 #endif //HIGHPRECISION_INTEGER_H
@@ -0,0 +1,498 @@
+#include "LimbArithmetic.h"
+#include "Instrumentation.h"
+
+#include <utility>
+
+// Inline assembly for x86-64 with GCC or Clang; define BIGINTEGER_NO_ASM to
+// build with the portable kernels only
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(BIGINTEGER_NO_ASM)
+#define BIGINTEGER_X86_64_ASM 1
+#endif
+
+namespace limbs {
+
+namespace {
+    limb_t add_n_generic(limb_t *r, const limb_t *a, const limb_t *b, size_t n) {
+        limb_t carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            limb_t sum = a[i] + carry;
+            carry = sum < carry;
+            limb_t result = sum + b[i];
+            carry += result < sum;
+            r[i] = result;
+        }
+        return carry;
+    }
+
+    limb_t sub_n_generic(limb_t *r, const limb_t *a, const limb_t *b, size_t n) {
+        limb_t borrow = 0;
+        for (size_t i = 0; i < n; ++i) {
+            limb_t subtrahend = b[i] + borrow;
+            borrow = subtrahend < borrow;
+            limb_t result = a[i] - subtrahend;
+            borrow += result > a[i];
+            r[i] = result;
+        }
+        return borrow;
+    }
+
+    limb_t mul_1_generic(limb_t *r, const limb_t *a, size_t n, limb_t b) {
+        limb_t carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            dlimb_t product = static_cast<dlimb_t>(a[i]) * b + carry;
+            r[i] = static_cast<limb_t>(product);
+            carry = static_cast<limb_t>(product >> LIMB_BITS);
+        }
+        return carry;
+    }
+
+    limb_t addmul_1_generic(limb_t *r, const limb_t *a, size_t n, limb_t b) {
+        limb_t carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            dlimb_t product = static_cast<dlimb_t>(a[i]) * b + r[i] + carry;
+            r[i] = static_cast<limb_t>(product);
+            carry = static_cast<limb_t>(product >> LIMB_BITS);
+        }
+        return carry;
+    }
+
+    limb_t submul_1_generic(limb_t *r, const limb_t *a, size_t n, limb_t b) {
+        limb_t carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            dlimb_t product = static_cast<dlimb_t>(a[i]) * b + carry;
+            limb_t low = static_cast<limb_t>(product);
+            carry = static_cast<limb_t>(product >> LIMB_BITS);
+            limb_t value = r[i];
+            r[i] = value - low;
+            carry += value < low;
+        }
+        return carry;
+    }
+
+#ifdef BIGINTEGER_X86_64_ASM
+    // The assembly loops below handle four limbs per iteration; the n % 4
+    // low limbs go through the portable kernels first and hand their carry
+    // on. Each loop reads a limb of every input before writing that limb of
+    // r, so r may alias an input exactly. Loop counters move with lea and
+    // jrcxz, which leave the carry flags alone.
+
+    // Plain adc chain, available on every x86-64
+    limb_t add_n_x86(limb_t *r, const limb_t *a, const limb_t *b, size_t n) {
+        size_t head = n % 4, blocks = n / 4;
+        limb_t carry = add_n_generic(r, a, b, head);
+        if (blocks == 0) return carry;
+        r += head, a += head, b += head;
+        limb_t t;
+        __asm__ volatile(
+                "neg %[carry]\n\t"                   // CF = carry
+                "1:\n\t"
+                "mov (%[a]), %[t]\n\t"
+                "adc (%[b]), %[t]\n\t"
+                "mov %[t], (%[r])\n\t"
+                "mov 8(%[a]), %[t]\n\t"
+                "adc 8(%[b]), %[t]\n\t"
+                "mov %[t], 8(%[r])\n\t"
+                "mov 16(%[a]), %[t]\n\t"
+                "adc 16(%[b]), %[t]\n\t"
+                "mov %[t], 16(%[r])\n\t"
+                "mov 24(%[a]), %[t]\n\t"
+                "adc 24(%[b]), %[t]\n\t"
+                "mov %[t], 24(%[r])\n\t"
+                "lea 32(%[a]), %[a]\n\t"
+                "lea 32(%[b]), %[b]\n\t"
+                "lea 32(%[r]), %[r]\n\t"
+                "lea -1(%[n]), %[n]\n\t"
+                "jrcxz 2f\n\t"
+                "jmp 1b\n"
+                "2:\n\t"
+                "mov $0, %[carry]\n\t"
+                "adc $0, %[carry]"
+                : [r] "+&r"(r), [a] "+&r"(a), [b] "+&r"(b), [n] "+&c"(blocks), [carry] "+&r"(carry), [t] "=&r"(t)
+                :
+                : "cc", "memory");
+        return carry;
+    }
+
+    limb_t sub_n_x86(limb_t *r, const limb_t *a, const limb_t *b, size_t n) {
+        size_t head = n % 4, blocks = n / 4;
+        limb_t borrow = sub_n_generic(r, a, b, head);
+        if (blocks == 0) return borrow;
+        r += head, a += head, b += head;
+        limb_t t;
+        __asm__ volatile(
+                "neg %[borrow]\n\t"                  // CF = borrow
+                "1:\n\t"
+                "mov (%[a]), %[t]\n\t"
+                "sbb (%[b]), %[t]\n\t"
+                "mov %[t], (%[r])\n\t"
+                "mov 8(%[a]), %[t]\n\t"
+                "sbb 8(%[b]), %[t]\n\t"
+                "mov %[t], 8(%[r])\n\t"
+                "mov 16(%[a]), %[t]\n\t"
+                "sbb 16(%[b]), %[t]\n\t"
+                "mov %[t], 16(%[r])\n\t"
+                "mov 24(%[a]), %[t]\n\t"
+                "sbb 24(%[b]), %[t]\n\t"
+                "mov %[t], 24(%[r])\n\t"
+                "lea 32(%[a]), %[a]\n\t"
+                "lea 32(%[b]), %[b]\n\t"
+                "lea 32(%[r]), %[r]\n\t"
+                "lea -1(%[n]), %[n]\n\t"
+                "jrcxz 2f\n\t"
+                "jmp 1b\n"
+                "2:\n\t"
+                "mov $0, %[borrow]\n\t"
+                "adc $0, %[borrow]"
+                : [r] "+&r"(r), [a] "+&r"(a), [b] "+&r"(b), [n] "+&c"(blocks), [borrow] "+&r"(borrow), [t] "=&r"(t)
+                :
+                : "cc", "memory");
+        return borrow;
+    }
+
+    // The multiply kernels need BMI2 (mulx, which leaves the flags alone)
+    // and, for the accumulating ones, ADX: adox carries the high halves of
+    // the products while adcx carries the additions into r, so the two
+    // chains run side by side instead of serializing.
+    bool has_mulx_adx() {
+        static const bool supported = (__builtin_cpu_init(),
+                __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("adx"));
+        return supported;
+    }
+
+    limb_t mul_1_mulx(limb_t *r, const limb_t *a, size_t n, limb_t b) {
+        size_t head = n % 4, blocks = n / 4;
+        limb_t carry = mul_1_generic(r, a, head, b);
+        if (blocks == 0) return carry;
+        r += head, a += head;
+        limb_t low, high;
+        __asm__ volatile(
+                "xor %k[low], %k[low]\n\t"            // CF = 0
+                "1:\n\t"
+                "mulx (%[a]), %[low], %[high]\n\t"
+                "adc %[carry], %[low]\n\t"
+                "mov %[low], (%[r])\n\t"
+                "mulx 8(%[a]), %[low], %[carry]\n\t"
+                "adc %[high], %[low]\n\t"
+                "mov %[low], 8(%[r])\n\t"
+                "mulx 16(%[a]), %[low], %[high]\n\t"
+                "adc %[carry], %[low]\n\t"
+                "mov %[low], 16(%[r])\n\t"
+                "mulx 24(%[a]), %[low], %[carry]\n\t"
+                "adc %[high], %[low]\n\t"
+                "mov %[low], 24(%[r])\n\t"
+                "lea 32(%[a]), %[a]\n\t"
+                "lea 32(%[r]), %[r]\n\t"
+                "lea -1(%[n]), %[n]\n\t"
+                "jrcxz 2f\n\t"
+                "jmp 1b\n"
+                "2:\n\t"
+                "adc $0, %[carry]"
+                : [r] "+&r"(r), [a] "+&r"(a), [n] "+&c"(blocks), [carry] "+&r"(carry),
+                  [low] "=&r"(low), [high] "=&r"(high)
+                : "d"(b)
+                : "cc", "memory");
+        return carry;
+    }
+
+    limb_t addmul_1_adx(limb_t *r, const limb_t *a, size_t n, limb_t b) {
+        size_t head = n % 4, blocks = n / 4;
+        limb_t carry = addmul_1_generic(r, a, head, b);
+        if (blocks == 0) return carry;
+        r += head, a += head;
+        limb_t low, high;
+        __asm__ volatile(
+                "xor %k[low], %k[low]\n\t"            // CF = OF = 0
+                "1:\n\t"
+                "mulx (%[a]), %[low], %[high]\n\t"
+                "adox %[carry], %[low]\n\t"
+                "adcx (%[r]), %[low]\n\t"
+                "mov %[low], (%[r])\n\t"
+                "mulx 8(%[a]), %[low], %[carry]\n\t"
+                "adox %[high], %[low]\n\t"
+                "adcx 8(%[r]), %[low]\n\t"
+                "mov %[low], 8(%[r])\n\t"
+                "mulx 16(%[a]), %[low], %[high]\n\t"
+                "adox %[carry], %[low]\n\t"
+                "adcx 16(%[r]), %[low]\n\t"
+                "mov %[low], 16(%[r])\n\t"
+                "mulx 24(%[a]), %[low], %[carry]\n\t"
+                "adox %[high], %[low]\n\t"
+                "adcx 24(%[r]), %[low]\n\t"
+                "mov %[low], 24(%[r])\n\t"
+                "lea 32(%[a]), %[a]\n\t"
+                "lea 32(%[r]), %[r]\n\t"
+                "lea -1(%[n]), %[n]\n\t"
+                "jrcxz 2f\n\t"
+                "jmp 1b\n"
+                "2:\n\t"
+                "mov $0, %k[low]\n\t"
+                "adox %[low], %[carry]\n\t"
+                "adcx %[low], %[carry]"
+                : [r] "+&r"(r), [a] "+&r"(a), [n] "+&c"(blocks), [carry] "+&r"(carry),
+                  [low] "=&r"(low), [high] "=&r"(high)
+                : "d"(b)
+                : "cc", "memory");
+        return carry;
+    }
+
+    // r - t is computed as r + ~t + 1, so the adcx chain carries "no borrow"
+    limb_t submul_1_adx(limb_t *r, const limb_t *a, size_t n, limb_t b) {
+        size_t head = n % 4, blocks = n / 4;
+        limb_t carry = submul_1_generic(r, a, head, b);
+        if (blocks == 0) return carry;
+        r += head, a += head;
+        limb_t low, high;
+        __asm__ volatile(
+                "xor %k[low], %k[low]\n\t"            // OF = 0
+                "stc\n\t"                             // CF = 1, no borrow yet
+                "1:\n\t"
+                "mulx (%[a]), %[low], %[high]\n\t"
+                "adox %[carry], %[low]\n\t"
+                "not %[low]\n\t"
+                "adcx (%[r]), %[low]\n\t"
+                "mov %[low], (%[r])\n\t"
+                "mulx 8(%[a]), %[low], %[carry]\n\t"
+                "adox %[high], %[low]\n\t"
+                "not %[low]\n\t"
+                "adcx 8(%[r]), %[low]\n\t"
+                "mov %[low], 8(%[r])\n\t"
+                "mulx 16(%[a]), %[low], %[high]\n\t"
+                "adox %[carry], %[low]\n\t"
+                "not %[low]\n\t"
+                "adcx 16(%[r]), %[low]\n\t"
+                "mov %[low], 16(%[r])\n\t"
+                "mulx 24(%[a]), %[low], %[carry]\n\t"
+                "adox %[high], %[low]\n\t"
+                "not %[low]\n\t"
+                "adcx 24(%[r]), %[low]\n\t"
+                "mov %[low], 24(%[r])\n\t"
+                "lea 32(%[a]), %[a]\n\t"
+                "lea 32(%[r]), %[r]\n\t"
+                "lea -1(%[n]), %[n]\n\t"
+                "jrcxz 2f\n\t"
+                "jmp 1b\n"
+                "2:\n\t"
+                "mov $0, %k[low]\n\t"
+                "adox %[low], %[carry]\n\t"
+                "cmc\n\t"                             // CF = final borrow
+                "adcx %[low], %[carry]"
+                : [r] "+&r"(r), [a] "+&r"(a), [n] "+&c"(blocks), [carry] "+&r"(carry),
+                  [low] "=&r"(low), [high] "=&r"(high)
+                : "d"(b)
+                : "cc", "memory");
+        return carry;
+    }
+#endif
+}
+
+limb_t add_n(limb_t *r, const limb_t *a, const limb_t *b, size_t n) {
+#ifdef BIGINTEGER_X86_64_ASM
+    return add_n_x86(r, a, b, n);
+#else
+    return add_n_generic(r, a, b, n);
+#endif
+}
+
+limb_t add(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn) {
+    limb_t carry = add_n(r, a, b, bn);
+    return add_1(r + bn, a + bn, an - bn, carry);
+}
+
+limb_t add_1(limb_t *r, const limb_t *a, size_t n, limb_t b) {
+    size_t i = 0;
+    for (; i < n && b; ++i) {
+        limb_t sum = a[i] + b;
+        b = sum < b;
+        r[i] = sum;
+    }
+    if (r != a) {
+        for (; i < n; ++i) r[i] = a[i];
+    }
+    return b;
+}
+
+limb_t sub_n(limb_t *r, const limb_t *a, const limb_t *b, size_t n) {
+#ifdef BIGINTEGER_X86_64_ASM
+    return sub_n_x86(r, a, b, n);
+#else
+    return sub_n_generic(r, a, b, n);
+#endif
+}
+
+limb_t sub(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn) {
+    limb_t borrow = sub_n(r, a, b, bn);
+    return sub_1(r + bn, a + bn, an - bn, borrow);
+}
+
+limb_t sub_1(limb_t *r, const limb_t *a, size_t n, limb_t b) {
+    size_t i = 0;
+    for (; i < n && b; ++i) {
+        limb_t value = a[i];
+        r[i] = value - b;
+        b = value < b;
+    }
+    if (r != a) {
+        for (; i < n; ++i) r[i] = a[i];
+    }
+    return b;
+}
+
+limb_t mul_1(limb_t *r, const limb_t *a, size_t n, limb_t b) {
+#ifdef BIGINTEGER_X86_64_ASM
+    if (has_mulx_adx()) return mul_1_mulx(r, a, n, b);
+#endif
+    return mul_1_generic(r, a, n, b);
+}
+
+limb_t addmul_1(limb_t *r, const limb_t *a, size_t n, limb_t b) {
+#ifdef BIGINTEGER_X86_64_ASM
+    if (has_mulx_adx()) return addmul_1_adx(r, a, n, b);
+#endif
+    return addmul_1_generic(r, a, n, b);
+}
+
+limb_t submul_1(limb_t *r, const limb_t *a, size_t n, limb_t b) {
+#ifdef BIGINTEGER_X86_64_ASM
+    if (has_mulx_adx()) return submul_1_adx(r, a, n, b);
+#endif
+    return submul_1_generic(r, a, n, b);
+}
+
+void mul_basecase(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn) {
+    r[an] = mul_1(r, a, an, b[0]);
+    for (size_t j = 1; j < bn; ++j) {
+        r[an + j] = addmul_1(r + j, a, an, b[j]);
+    }
+}
+
+void sqr_basecase(limb_t *r, const limb_t *a, size_t n) {
+    // Each cross product a[i] a[j], i < j, once, then doubled, then the
+    // squares a[i]^2 added along the diagonal
+    r[0] = 0;
+    r[2 * n - 1] = 0;
+    if (n > 1) {
+        r[n] = mul_1(r + 1, a + 1, n - 1, a[0]);
+        for (size_t i = 1; i + 1 < n; ++i) {
+            r[n + i] = addmul_1(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+        }
+        lshift(r, r, 2 * n, 1);
+    }
+    limb_t carry = 0;
+    for (size_t i = 0; i < n; ++i) {
+        dlimb_t square = static_cast<dlimb_t>(a[i]) * a[i];
+        dlimb_t low = static_cast<dlimb_t>(r[2 * i]) + static_cast<limb_t>(square) + carry;
+        r[2 * i] = static_cast<limb_t>(low);
+        dlimb_t high = static_cast<dlimb_t>(r[2 * i + 1]) + static_cast<limb_t>(square >> LIMB_BITS)
+                       + static_cast<limb_t>(low >> LIMB_BITS);
+        r[2 * i + 1] = static_cast<limb_t>(high);
+        carry = static_cast<limb_t>(high >> LIMB_BITS);
+    }
+}
+
+limb_t divrem_1(limb_t *q, const limb_t *a, size_t n, limb_t d) {
+    limb_t remainder = 0;
+    for (size_t i = n; i-- > 0;) {
+        dlimb_t current = (static_cast<dlimb_t>(remainder) << LIMB_BITS) | a[i];
+        q[i] = static_cast<limb_t>(current / d);
+        remainder = static_cast<limb_t>(current % d);
+    }
+    return remainder;
+}
+
+limb_t gcd_1(limb_t a, limb_t b) {
+    if (a == 0) return b;
+    if (b == 0) return a;
+    int shift = __builtin_ctzll(a | b);
+    a >>= __builtin_ctzll(a);
+    while (b != 0) {
+        b >>= __builtin_ctzll(b);
+        if (a > b) std::swap(a, b);
+        b -= a;
+    }
+    return a << shift;
+}
+
+void divexact_1(limb_t *q, const limb_t *a, size_t n, limb_t d) {
+    // Newton iteration for d^-1 mod 2^64; each step doubles the number of correct bits
+    limb_t inverse = d;
+    for (int i = 0; i < 5; ++i) inverse *= 2 - d * inverse;
+    limb_t borrow = 0;
+    for (size_t i = 0; i < n; ++i) {
+        limb_t value = a[i];
+        limb_t difference = value - borrow;
+        borrow = difference > value;
+        limb_t quotient = difference * inverse;
+        q[i] = quotient;
+        borrow += static_cast<limb_t>((static_cast<dlimb_t>(quotient) * d) >> LIMB_BITS);
+    }
+}
+
+limb_t lshift(limb_t *r, const limb_t *a, size_t n, unsigned count) {
+    limb_t out = 0;
+    for (size_t i = n; i-- > 0;) {
+        limb_t value = a[i];
+        if (i + 1 == n) out = value >> (LIMB_BITS - count);
+        r[i] = (value << count) | (i > 0 ? a[i - 1] >> (LIMB_BITS - count) : 0);
+    }
+    return out;
+}
+
+limb_t rshift(limb_t *r, const limb_t *a, size_t n, unsigned count) {
+    if (n == 0) return 0;
+    limb_t out = a[0] << (LIMB_BITS - count);
+    for (size_t i = 0; i + 1 < n; ++i) {
+        r[i] = (a[i] >> count) | (a[i + 1] << (LIMB_BITS - count));
+    }
+    r[n - 1] = a[n - 1] >> count;
+    return out;
+}
+
+int cmp(const limb_t *a, const limb_t *b, size_t n) {
+    for (size_t i = n; i-- > 0;) {
+        if (a[i] != b[i]) return a[i] > b[i] ? 1 : -1;
+    }
+    return 0;
+}
+
+size_t normalized_size(const limb_t *a, size_t n) {
+    while (n > 0 && a[n - 1] == 0) --n;
+    return n;
+}
+
+namespace {
+    // The heap behind the scratch pools, counting the blocks they take when
+    // instrumentation is on
+    std::pmr::memory_resource *scratch_upstream() {
+#ifdef BIGINTEGER_INSTRUMENTATION
+        class CountingResource : public std::pmr::memory_resource {
+            void *do_allocate(size_t bytes, size_t alignment) override {
+                instrumentation::recordScratchAllocation(bytes);
+                return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+            }
+
+            void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+                std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+            }
+
+            [[nodiscard]] bool do_is_equal(const memory_resource &other) const noexcept override {
+                return this == &other;
+            }
+        };
+        // Never destroyed, as the pools of threads exiting late still free into it
+        static auto *counting = new CountingResource;
+        return counting;
+#else
+        return std::pmr::new_delete_resource();
+#endif
+    }
+}
+
+std::pmr::memory_resource *scratch_resource() {
+    // Pools blocks of up to 16 MB; larger requests go straight to the heap,
+    // where the allocation is cheap next to the arithmetic done on them
+    thread_local std::pmr::unsynchronized_pool_resource pool(std::pmr::pool_options{0, size_t(1) << 24},
+                                                             scratch_upstream());
+    return &pool;
+}
+
+}
@@ -0,0 +1,156 @@
+#ifndef BIGINTEGER_LIMBARITHMETIC_H
+#define BIGINTEGER_LIMBARITHMETIC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+// Low-level routines on little-endian arrays of 64-bit limbs, the building
+// blocks behind BigInteger. Unless noted otherwise, the result may alias an
+// input exactly but must not partially overlap it, and returned values are
+// the carry/borrow out of the most significant limb.
+namespace limbs {
+    using limb_t = std::uint64_t;
+    using dlimb_t = unsigned __int128;
+
+    constexpr int LIMB_BITS = 64;
+
+    // r[0..n) = a[0..n) + b[0..n)
+    limb_t add_n(limb_t *r, const limb_t *a, const limb_t *b, size_t n);
+
+    // r[0..an) = a[0..an) + b[0..bn), requires an >= bn
+    limb_t add(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn);
+
+    // r[0..n) = a[0..n) + b
+    limb_t add_1(limb_t *r, const limb_t *a, size_t n, limb_t b);
+
+    // r[0..n) = a[0..n) - b[0..n)
+    limb_t sub_n(limb_t *r, const limb_t *a, const limb_t *b, size_t n);
+
+    // r[0..an) = a[0..an) - b[0..bn), requires an >= bn
+    limb_t sub(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn);
+
+    // r[0..n) = a[0..n) - b
+    limb_t sub_1(limb_t *r, const limb_t *a, size_t n, limb_t b);
+
+    // r[0..n) = a[0..n) * b
+    limb_t mul_1(limb_t *r, const limb_t *a, size_t n, limb_t b);
+
+    // r[0..n) += a[0..n) * b
+    limb_t addmul_1(limb_t *r, const limb_t *a, size_t n, limb_t b);
+
+    // r[0..n) -= a[0..n) * b
+    limb_t submul_1(limb_t *r, const limb_t *a, size_t n, limb_t b);
+
+    // r[0..an+bn) = a[0..an) * b[0..bn), an, bn >= 1, r must not overlap a or b
+    void mul_basecase(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn);
+
+    // r[0..2n) = a[0..n)^2, n >= 1, r must not overlap a. Forms each cross
+    // product once, about half the work of mul_basecase(r, a, n, a, n).
+    void sqr_basecase(limb_t *r, const limb_t *a, size_t n);
+
+    // r[0..an+bn) = a[0..an) * b[0..bn), an >= bn >= 1, r must not overlap a or b.
+    // Dispatches between the basecase, Karatsuba and Toom-Cook by operand size.
+    void mul(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn);
+
+    // r[0..2n) = a[0..n) * b[0..n), n >= 1, r must not overlap a or b
+    void mul_n(limb_t *r, const limb_t *a, const limb_t *b, size_t n);
+
+    // r[0..2n) = a[0..n)^2, n >= 1, r must not overlap a
+    void sqr(limb_t *r, const limb_t *a, size_t n);
+
+    // Exact multiplication through number-theoretic transforms modulo three
+    // primes and CRT recombination, for operands past the Toom-Cook range.
+    // Same contract as mul() and sqr().
+    void mul_fft(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn);
+
+    void sqr_fft(limb_t *r, const limb_t *a, size_t n);
+
+    // q[0..n) = a[0..n) / d, returns the remainder. q may alias a.
+    limb_t divrem_1(limb_t *q, const limb_t *a, size_t n, limb_t d);
+
+    // q[0..an-dn+1) = a[0..an) / d[0..dn) and r[0..dn) = a mod d, for an >= dn >= 1
+    // and d[dn-1] != 0. Schoolbook (Knuth D) for small divisors, divide-and-conquer
+    // above. q and r must not overlap the inputs or each other.
+    void divrem(limb_t *q, limb_t *r, const limb_t *a, size_t an, const limb_t *d, size_t dn);
+
+    // q[0..n) = a[0..n) / d for odd d that divides a exactly. q may alias a.
+    void divexact_1(limb_t *q, const limb_t *a, size_t n, limb_t d);
+
+    // Greatest common divisor of two limbs by the binary algorithm; gcd_1(0, 0) = 0
+    limb_t gcd_1(limb_t a, limb_t b);
+
+    // r[0..n) = a[0..n) << count, 0 < count < LIMB_BITS, returns the bits shifted out.
+    // r may alias a or sit above it.
+    limb_t lshift(limb_t *r, const limb_t *a, size_t n, unsigned count);
+
+    // r[0..n) = a[0..n) >> count, 0 < count < LIMB_BITS, returns the bits shifted out
+    // in the high end of the limb. r may alias a or sit below it.
+    limb_t rshift(limb_t *r, const limb_t *a, size_t n, unsigned count);
+
+    // Most decimal digits an n-limb value can have, as 64 log10(2) < 19.27
+    inline size_t decimal_size_bound(size_t n) { return n * 1927 / 100 + 1; }
+
+    // Writes the decimal digits of a[0..n), n >= 1 and a[n-1] != 0, without
+    // leading zeros to out, which has room for decimal_size_bound(n) of them,
+    // and returns their end. Large values are split recursively by cached
+    // powers 10^(19 2^k).
+    char *to_decimal(char *out, const limb_t *a, size_t n);
+
+    // The same digits as a string
+    std::string to_decimal(const limb_t *a, size_t n);
+
+    // Normalized limbs of the digit string [first, last), which must hold only '0'..'9'
+    std::vector<limb_t> from_decimal(const char *first, const char *last);
+
+    // Normalized limbs of 10^exponent, built from the powers to_decimal and
+    // from_decimal cache
+    std::vector<limb_t> power_of_ten(size_t exponent);
+
+    // Value of the digit c in radix 2^bits, 1 <= bits <= 6, or -1 for a
+    // character that is not one. Radices up to 32 take 0-9 then a-v in
+    // either case, radix 64 the base64 alphabet A-Z a-z 0-9 + /.
+    int radix_digit(char c, unsigned bits);
+
+    // Writes the digits of a[0..n), n >= 1 and a[n-1] != 0, in radix 2^bits
+    // without leading zeros to out, which has room for them, and returns their end
+    char *to_radix_pow2(char *out, const limb_t *a, size_t n, unsigned bits);
+
+    // Stores the digits [first, last) in radix 2^bits, which must all be
+    // valid, into r: (last - first) bits / LIMB_BITS limbs, rounded up, of zeros
+    void from_radix_pow2(limb_t *r, const char *first, const char *last, unsigned bits);
+
+    // Three-way comparison of a[0..n) and b[0..n): -1, 0 or 1
+    int cmp(const limb_t *a, const limb_t *b, size_t n);
+
+    // Length of a[0..n) with the high zero limbs removed
+    size_t normalized_size(const limb_t *a, size_t n);
+
+    // Per-thread pool for the temporaries of multiplication, division and
+    // conversion. Freed blocks are kept for reuse by later calls on the same
+    // thread, so steady-state arithmetic neither locks nor grows the heap.
+    // Memory from it must be freed on the thread that allocated it.
+    std::pmr::memory_resource *scratch_resource();
+
+    using scratch_vector = std::pmr::vector<limb_t>;
+
+    // Opt-in multithreading for huge operands. With threads > 1, products of
+    // at least cutoff limbs (and so the divisions built on them) split their
+    // independent parts over a pool of that many threads, the calling one
+    // included. Must not be called while arithmetic runs on other threads.
+    // Work handed to the pool writes only into buffers its caller allocated,
+    // as scratch memory has to be freed on the thread that took it.
+    void set_parallelism(size_t threads, size_t cutoff);
+
+    // Whether work on n-limb operands should fan out over the pool
+    bool use_parallel(size_t n);
+
+    // Calls body(i) for every i < count: spread over the pool when parallel
+    // is set and there is a pool, in order on the calling thread otherwise
+    void parallel_for(bool parallel, size_t count, const std::function<void(size_t)> &body);
+}
+
+#endif //BIGINTEGER_LIMBARITHMETIC_H
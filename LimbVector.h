@@ -0,0 +1,183 @@
+#ifndef BIGINTEGER_LIMBVECTOR_H
+#define BIGINTEGER_LIMBVECTOR_H
+
+#include "Instrumentation.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+// Growable array of 64-bit limbs backing BigInteger. Up to INLINE_CAPACITY
+// limbs live inside the object itself, so small values never allocate; longer
+// ones spill to memory from a std::pmr::memory_resource. Limbs added by
+// resize() are zeroed.
+//
+// The resource is fixed at construction, as with the std::pmr containers:
+// copies take the current resource, moves keep the source's, and assignment
+// never changes it. The current resource is the thread's scoped one if a
+// ResourceScope is active, otherwise std::pmr::get_default_resource().
+class LimbVector {
+public:
+    static constexpr size_t INLINE_CAPACITY = 4;
+
+    // Makes resource the current one on this thread for the scope's lifetime
+    class ResourceScope {
+    public:
+        explicit ResourceScope(std::pmr::memory_resource *resource) : previous(scopedResource()) {
+            scopedResource() = resource;
+        }
+
+        ~ResourceScope() { scopedResource() = previous; }
+
+        ResourceScope(const ResourceScope &) = delete;
+
+        ResourceScope &operator=(const ResourceScope &) = delete;
+
+    private:
+        std::pmr::memory_resource *previous;
+    };
+
+    static std::pmr::memory_resource *currentResource() {
+        std::pmr::memory_resource *scoped = scopedResource();
+        return scoped != nullptr ? scoped : std::pmr::get_default_resource();
+    }
+
+    explicit LimbVector(std::pmr::memory_resource *resource = currentResource()) noexcept
+            : pointer(inlineStorage), length(0), capacity(INLINE_CAPACITY), memory(resource) {}
+
+    LimbVector(const LimbVector &other, std::pmr::memory_resource *resource = currentResource())
+            : LimbVector(resource) {
+        assign(other.begin(), other.end());
+    }
+
+    LimbVector(LimbVector &&other) noexcept : LimbVector(other.memory) {
+        steal(other);
+    }
+
+    LimbVector &operator=(const LimbVector &other) {
+        if (this != &other) assign(other.begin(), other.end());
+        return *this;
+    }
+
+    LimbVector &operator=(LimbVector &&other) {
+        if (this == &other) return *this;
+        if (*memory == *other.memory) {
+            release();
+            steal(other);
+        } else {
+            // Storage from another resource cannot be adopted, only copied
+            assign(other.begin(), other.end());
+        }
+        return *this;
+    }
+
+    ~LimbVector() { release(); }
+
+    [[nodiscard]] std::pmr::memory_resource *resource() const { return memory; }
+
+    [[nodiscard]] size_t size() const { return length; }
+
+    [[nodiscard]] bool empty() const { return length == 0; }
+
+    uint64_t *data() { return pointer; }
+
+    const uint64_t *data() const { return pointer; }
+
+    uint64_t *begin() { return pointer; }
+
+    uint64_t *end() { return pointer + length; }
+
+    const uint64_t *begin() const { return pointer; }
+
+    const uint64_t *end() const { return pointer + length; }
+
+    uint64_t &operator[](size_t index) { return pointer[index]; }
+
+    const uint64_t &operator[](size_t index) const { return pointer[index]; }
+
+    uint64_t &back() { return pointer[length - 1]; }
+
+    const uint64_t &back() const { return pointer[length - 1]; }
+
+    void reserve(size_t n) {
+        if (n <= capacity) return;
+        uint64_t *grown = allocate(n);
+        std::copy(pointer, pointer + length, grown);
+        release();
+        pointer = grown;
+        capacity = n;
+    }
+
+    void resize(size_t n) {
+        if (n > capacity) reserve(std::max(n, 2 * capacity));
+        if (n > length) std::fill(pointer + length, pointer + n, 0);
+        length = n;
+    }
+
+    void push_back(uint64_t limb) {
+        if (length == capacity) reserve(2 * capacity);
+        pointer[length++] = limb;
+    }
+
+    void pop_back() { --length; }
+
+    void clear() { length = 0; }
+
+    void assign(const uint64_t *first, const uint64_t *last) {
+        auto n = static_cast<size_t>(last - first);
+        if (n > capacity) {
+            // Source limbs may live in our own buffer, so copy before freeing it
+            uint64_t *grown = allocate(n);
+            std::copy(first, last, grown);
+            release();
+            pointer = grown;
+            capacity = n;
+        } else {
+            std::copy(first, last, pointer);
+        }
+        length = n;
+    }
+
+private:
+    uint64_t *pointer;
+    size_t length;
+    size_t capacity;
+    std::pmr::memory_resource *memory;
+    uint64_t inlineStorage[INLINE_CAPACITY];
+
+    static std::pmr::memory_resource *&scopedResource() {
+        thread_local std::pmr::memory_resource *resource = nullptr;
+        return resource;
+    }
+
+    [[nodiscard]] bool isInline() const { return pointer == inlineStorage; }
+
+    uint64_t *allocate(size_t n) {
+        instrumentation::recordAllocation(n * sizeof(uint64_t));
+        return static_cast<uint64_t *>(memory->allocate(n * sizeof(uint64_t), alignof(uint64_t)));
+    }
+
+    void release() {
+        if (!isInline()) memory->deallocate(pointer, capacity * sizeof(uint64_t), alignof(uint64_t));
+        pointer = inlineStorage;
+        capacity = INLINE_CAPACITY;
+    }
+
+    // Takes over other's limbs and leaves it empty; *this must hold no heap
+    // buffer and share other's resource
+    void steal(LimbVector &other) noexcept {
+        if (other.isInline()) {
+            std::copy(other.pointer, other.pointer + other.length, inlineStorage);
+        } else {
+            pointer = other.pointer;
+            capacity = other.capacity;
+            other.pointer = other.inlineStorage;
+            other.capacity = INLINE_CAPACITY;
+        }
+        length = other.length;
+        other.length = 0;
+    }
+};
+
+#endif //BIGINTEGER_LIMBVECTOR_H
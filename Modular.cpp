@@ -0,0 +1,295 @@
+#include "Modular.h"
+#include "LimbArithmetic.h"
+
+#include <algorithm>
+#include <iterator>
+
+using limbs::limb_t;
+
+namespace {
+    // Exponent sizes, in bits, above which the next wider window pays off
+    constexpr size_t WINDOW_THRESHOLDS[] = {7, 25, 81, 241, 673, 1793};
+
+    // Window of the constant-time exponentiation, whose table is always full
+    constexpr size_t FIXED_WINDOW = 4;
+}
+
+ModularContext::ModularContext(const BigInteger &modulus) : modulusValue(modulus) {
+    if (modulus.negative || modulus.data.empty()) throw std::runtime_error("Modulus must be positive");
+    m.assign(modulus.data.begin(), modulus.data.end());
+    n = m.size();
+}
+
+BigInteger ModularContext::fromLimbs(const limb_t *a, size_t size) {
+    BigInteger result;
+    result.data.assign(a, a + size);
+    result.normalize();
+    return result;
+}
+
+void ModularContext::residue(limb_t *r, const BigInteger &x) const {
+    const BigInteger *value = &x;
+    BigInteger reduced;
+    if (x.negative || BigInteger::compareAbsolute(x, modulusValue) >= 0) {
+        reduced = x % modulusValue;
+        if (reduced.negative) reduced += modulusValue;
+        value = &reduced;
+    }
+    std::copy(value->data.begin(), value->data.end(), r);
+    std::fill(r + value->data.size(), r + n, 0);
+}
+
+BigInteger ModularContext::reduce(const BigInteger &x) const {
+    limbs::scratch_vector r(n, limbs::scratch_resource());
+    residue(r.data(), x);
+    return fromLimbs(r.data(), n);
+}
+
+BigInteger ModularContext::multiply(const BigInteger &a, const BigInteger &b) const {
+    limbs::scratch_vector buffer(2 * n + scratchLimbs, limbs::scratch_resource());
+    limb_t *x = buffer.data(), *y = x + n;
+    toElement(x, a);
+    toElement(y, b);
+    mulmod(x, x, y, y + n);
+    return fromElement(x);
+}
+
+BigInteger ModularContext::pow(const BigInteger &base, const BigInteger &exponent) const {
+    if (exponent.negative) throw std::runtime_error("Negative exponent");
+    if (n == 1 && m[0] == 1) return 0;
+    size_t bits = exponent.bitLength();
+    if (bits == 0) return 1;
+    const limb_t *e = exponent.data.data();
+    auto bit = [e](size_t i) { return (e[i / limbs::LIMB_BITS] >> (i % limbs::LIMB_BITS)) & 1; };
+
+    size_t window = 1;
+    while (window <= std::size(WINDOW_THRESHOLDS) && bits > WINDOW_THRESHOLDS[window - 1]) ++window;
+
+    // table holds base^1, base^3, ..., base^(2^window - 1)
+    size_t entries = size_t(1) << (window - 1);
+    limbs::scratch_vector buffer((entries + 2) * n + scratchLimbs, limbs::scratch_resource());
+    limb_t *table = buffer.data(), *acc = table + entries * n, *square = acc + n, *scratch = square + n;
+    toElement(table, base);
+    if (entries > 1) {
+        sqrmod(square, table, scratch);
+        for (size_t i = 1; i < entries; ++i) mulmod(table + i * n, table + (i - 1) * n, square, scratch);
+    }
+
+    // Left to right; each window runs from a set bit down to the lowest set
+    // bit at most window - 1 places below it. The top bit starts the first one.
+    bool started = false;
+    size_t i = bits;
+    while (i > 0) {
+        size_t top = i - 1;
+        if (!bit(top)) {
+            sqrmod(acc, acc, scratch);
+            i = top;
+            continue;
+        }
+        size_t low = top + 1 >= window ? top + 1 - window : 0;
+        while (!bit(low)) ++low;
+        size_t value = 0;
+        for (size_t j = top + 1; j-- > low;) value = value << 1 | bit(j);
+        const limb_t *entry = table + (value >> 1) * n;
+        if (started) {
+            for (size_t j = low; j <= top; ++j) sqrmod(acc, acc, scratch);
+            mulmod(acc, acc, entry, scratch);
+        } else {
+            std::copy(entry, entry + n, acc);
+            started = true;
+        }
+        i = low;
+    }
+    return fromElement(acc);
+}
+
+MontgomeryContext::MontgomeryContext(const BigInteger &modulus) : ModularContext(modulus) {
+    if ((m[0] & 1) == 0) throw std::runtime_error("Montgomery reduction needs an odd modulus");
+    // Newton iteration for m^-1 mod 2^64; each step doubles the number of correct bits
+    limb_t inverse = m[0];
+    for (int i = 0; i < 5; ++i) inverse *= 2 - m[0] * inverse;
+    negInverse = 0 - inverse;
+
+    // R^2 mod m as the remainder of 2^(128 n) / m
+    std::vector<limb_t> power(2 * n + 1, 0), quotient(n + 2);
+    power[2 * n] = 1;
+    rSquared.resize(n);
+    limbs::divrem(quotient.data(), rSquared.data(), power.data(), power.size(), m.data(), n);
+    scratchLimbs = 2 * n;
+}
+
+void MontgomeryContext::redc(limb_t *r, limb_t *t) const {
+    // Step i clears t[i]; its carry belongs at t[i + n] and is parked in
+    // t[i] meanwhile, since no later step reads that position
+    for (size_t i = 0; i < n; ++i) {
+        limb_t u = t[i] * negInverse;
+        t[i] = limbs::addmul_1(t + i, m.data(), n, u);
+    }
+    limb_t carry = limbs::add_n(r, t + n, t, n);
+    if (carry || limbs::cmp(r, m.data(), n) >= 0) limbs::sub_n(r, r, m.data(), n);
+}
+
+void MontgomeryContext::toElement(limb_t *r, const BigInteger &x) const {
+    limbs::scratch_vector scratch(2 * n, limbs::scratch_resource());
+    residue(r, x);
+    mulmod(r, r, rSquared.data(), scratch.data());
+}
+
+BigInteger MontgomeryContext::fromElement(const limb_t *a) const {
+    limbs::scratch_vector t(3 * n, 0, limbs::scratch_resource());
+    std::copy(a, a + n, t.data());
+    redc(t.data() + 2 * n, t.data());
+    return fromLimbs(t.data() + 2 * n, n);
+}
+
+void MontgomeryContext::mulmod(limb_t *r, const limb_t *a, const limb_t *b, limb_t *scratch) const {
+    if (a == b) limbs::sqr(scratch, a, n);
+    else limbs::mul(scratch, a, n, b, n);
+    redc(r, scratch);
+}
+
+void MontgomeryContext::sqrmod(limb_t *r, const limb_t *a, limb_t *scratch) const {
+    limbs::sqr(scratch, a, n);
+    redc(r, scratch);
+}
+
+BigInteger MontgomeryContext::powConstantTime(const BigInteger &base, const BigInteger &exponent) const {
+    if (exponent.negative) throw std::runtime_error("Negative exponent");
+    if (n == 1 && m[0] == 1) return 0;
+
+    constexpr size_t entries = size_t(1) << FIXED_WINDOW;
+    limbs::scratch_vector buffer((entries + 4) * n, limbs::scratch_resource());
+    limb_t *table = buffer.data(), *acc = table + entries * n, *entry = acc + n, *t = entry + n;
+
+    // r = a if keep is all ones, b if it is zero
+    auto select = [&](limb_t *r, const limb_t *a, const limb_t *b, limb_t keep) {
+        for (size_t i = 0; i < n; ++i) r[i] = (a[i] & keep) | (b[i] & ~keep);
+    };
+    // Only the operand sizes steer the product and the reduction: the
+    // schoolbook product, a REDC whose final subtraction is always done
+    // and kept or dropped by mask
+    auto multiply = [&](limb_t *r, const limb_t *a, const limb_t *b) {
+        limbs::mul_basecase(t, a, n, b, n);
+        for (size_t i = 0; i < n; ++i) t[i] = limbs::addmul_1(t + i, m.data(), n, t[i] * negInverse);
+        limb_t carry = limbs::add_n(r, t + n, t, n);
+        limb_t borrow = limbs::sub_n(t, r, m.data(), n);
+        select(r, t, r, 0 - (carry | (borrow ^ 1)));
+    };
+    // r = a + b mod m for a, b < m, the same way
+    auto add = [&](limb_t *r, const limb_t *a, const limb_t *b) {
+        limb_t carry = limbs::add_n(r, a, b, n);
+        limb_t borrow = limbs::sub_n(t, r, m.data(), n);
+        select(r, t, r, 0 - (carry | (borrow ^ 1)));
+    };
+    auto setOne = [&](limb_t *r) {
+        std::fill(r, r + n, 0);
+        r[0] = 1;
+    };
+
+    // table[0] = R mod m, the Montgomery form of 1
+    setOne(entry);
+    multiply(table, entry, rSquared.data());
+    // table[1] = base R mod m by Horner's rule over its n-limb chunks c, as
+    // multiply(c, R^2) = c R mod m for any c < R. Only the sign and the
+    // number of limbs of base decide the steps.
+    std::fill(acc, acc + n, 0);
+    size_t baseSize = base.data.size(), chunks = (baseSize + n - 1) / n;
+    for (size_t j = chunks; j-- > 0;) {
+        if (j + 1 < chunks) multiply(acc, acc, rSquared.data());
+        size_t low = j * n, length = std::min(n, baseSize - low);
+        std::copy(base.data.begin() + low, base.data.begin() + low + length, entry);
+        std::fill(entry + length, entry + n, 0);
+        multiply(entry, entry, rSquared.data());
+        add(acc, acc, entry);
+    }
+    if (base.negative) {
+        // m - acc lies in (0, m]; m itself is taken back to 0 by mask
+        limbs::sub_n(entry, m.data(), acc, n);
+        limb_t borrow = limbs::sub_n(t, entry, m.data(), n);
+        select(acc, t, entry, 0 - (borrow ^ 1));
+    }
+    std::copy(acc, acc + n, table + n);
+    for (size_t i = 2; i < entries; ++i) multiply(table + i * n, table + (i - 1) * n, table + n);
+
+    // Every window of the exponent's limbs is processed, zero or not
+    std::copy(table, table + n, acc);
+    const limb_t *e = exponent.data.data();
+    size_t bits = exponent.data.size() * limbs::LIMB_BITS;
+    for (size_t i = bits; i > 0; i -= FIXED_WINDOW) {
+        for (size_t j = 0; j < FIXED_WINDOW; ++j) multiply(acc, acc, acc);
+        size_t low = i - FIXED_WINDOW;
+        limb_t value = (e[low / limbs::LIMB_BITS] >> (low % limbs::LIMB_BITS)) & (entries - 1);
+        // Read every entry and keep the wanted one
+        std::fill(entry, entry + n, 0);
+        for (size_t k = 0; k < entries; ++k) {
+            limb_t mask = 0 - static_cast<limb_t>(k == value);
+            for (size_t l = 0; l < n; ++l) entry[l] |= table[k * n + l] & mask;
+        }
+        multiply(acc, acc, entry);
+    }
+
+    // Out of Montgomery form as acc * 1 R^-1, through the same masked REDC
+    setOne(entry);
+    multiply(acc, acc, entry);
+    return fromLimbs(acc, n);
+}
+
+BarrettContext::BarrettContext(const BigInteger &modulus) : ModularContext(modulus) {
+    // mu = floor(2^(128 n) / m), n + 1 or n + 2 limbs long
+    std::vector<limb_t> power(2 * n + 1, 0), remainder(n);
+    power[2 * n] = 1;
+    mu.resize(n + 2);
+    limbs::divrem(mu.data(), remainder.data(), power.data(), power.size(), m.data(), n);
+    mu.resize(limbs::normalized_size(mu.data(), mu.size()));
+    scratchLimbs = 2 * n + (n + 1 + mu.size()) + 2 * (n + 1);
+}
+
+void BarrettContext::reduceProduct(limb_t *r, limb_t *t, limb_t *scratch) const {
+    // q = floor(floor(t / B^(n-1)) mu / B^(n+1)) undershoots floor(t / m) by at most 2
+    const limb_t *q1 = t + n - 1;
+    size_t q2Size = n + 1 + mu.size();
+    limb_t *q2 = scratch, *qm = q2 + q2Size, *remainder = qm + n + 1;
+    if (mu.size() >= n + 1) limbs::mul(q2, mu.data(), mu.size(), q1, n + 1);
+    else limbs::mul(q2, q1, n + 1, mu.data(), mu.size());
+    // q < m, so its limbs from n up are zero. Only q m mod B^(n+1) is
+    // needed, which takes the rows of the schoolbook product cut short.
+    const limb_t *q = q2 + n + 1;
+    std::fill(qm, qm + n + 1, 0);
+    qm[n] = limbs::addmul_1(qm, m.data(), n, q[0]);
+    for (size_t i = 1; i < n; ++i) limbs::addmul_1(qm + i, m.data(), n + 1 - i, q[i]);
+
+    // t - q m < 3m < B^(n+1), so working modulo B^(n+1) is exact
+    limbs::sub_n(remainder, t, qm, n + 1);
+    while (remainder[n] != 0 || limbs::cmp(remainder, m.data(), n) >= 0) {
+        remainder[n] -= limbs::sub_n(remainder, remainder, m.data(), n);
+    }
+    std::copy(remainder, remainder + n, r);
+}
+
+void BarrettContext::toElement(limb_t *r, const BigInteger &x) const {
+    residue(r, x);
+}
+
+BigInteger BarrettContext::fromElement(const limb_t *a) const {
+    return fromLimbs(a, n);
+}
+
+void BarrettContext::mulmod(limb_t *r, const limb_t *a, const limb_t *b, limb_t *scratch) const {
+    if (a == b) limbs::sqr(scratch, a, n);
+    else limbs::mul(scratch, a, n, b, n);
+    reduceProduct(r, scratch, scratch + 2 * n);
+}
+
+void BarrettContext::sqrmod(limb_t *r, const limb_t *a, limb_t *scratch) const {
+    limbs::sqr(scratch, a, n);
+    reduceProduct(r, scratch, scratch + 2 * n);
+}
+
+BigInteger powMod(const BigInteger &base, const BigInteger &exponent, const BigInteger &modulus) {
+    if (modulus.isOdd()) return MontgomeryContext(modulus).pow(base, exponent);
+    return BarrettContext(modulus).pow(base, exponent);
+}
+
+BigInteger powModConstantTime(const BigInteger &base, const BigInteger &exponent, const BigInteger &modulus) {
+    return MontgomeryContext(modulus).powConstantTime(base, exponent);
+}
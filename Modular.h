@@ -0,0 +1,124 @@
+#ifndef BIGINTEGER_MODULAR_H
+#define BIGINTEGER_MODULAR_H
+
+#include "BigInteger.h"
+
+#include <cstdint>
+#include <vector>
+
+// Arithmetic modulo a fixed positive modulus m. A context does the per-modulus
+// setup once, so repeated operations with the same modulus only pay for the
+// multiplications. Results are always in [0, m), whatever the sign of the
+// inputs. Contexts are immutable after construction and may be shared
+// between threads.
+class ModularContext {
+public:
+    virtual ~ModularContext() = default;
+
+    [[nodiscard]] const BigInteger &modulus() const { return modulusValue; }
+
+    // x mod m
+    [[nodiscard]] BigInteger reduce(const BigInteger &x) const;
+
+    // a * b mod m
+    [[nodiscard]] BigInteger multiply(const BigInteger &a, const BigInteger &b) const;
+
+    // base^exponent mod m by sliding-window exponentiation, for exponent >= 0
+    [[nodiscard]] BigInteger pow(const BigInteger &base, const BigInteger &exponent) const;
+
+protected:
+    friend class NumberTheory;
+
+    explicit ModularContext(const BigInteger &modulus);
+
+    BigInteger modulusValue;
+    // m in exactly n limbs, the top one non-zero
+    std::vector<uint64_t> m;
+    size_t n;
+    // Limbs of workspace that mulmod() and sqrmod() need
+    size_t scratchLimbs = 0;
+
+    // Elements are n-limb arrays in the representation of the derived
+    // context; r may alias a or b
+
+    virtual void toElement(uint64_t *r, const BigInteger &x) const = 0;
+
+    [[nodiscard]] virtual BigInteger fromElement(const uint64_t *a) const = 0;
+
+    virtual void mulmod(uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t *scratch) const = 0;
+
+    virtual void sqrmod(uint64_t *r, const uint64_t *a, uint64_t *scratch) const = 0;
+
+    // Writes x mod m as n limbs
+    void residue(uint64_t *r, const BigInteger &x) const;
+
+    static BigInteger fromLimbs(const uint64_t *a, size_t size);
+};
+
+// Montgomery multiplication for odd moduli: elements are kept as x R mod m
+// with R = 2^(64 n), and each product is reduced by n word-sized steps
+// instead of a division.
+class MontgomeryContext : public ModularContext {
+public:
+    // Throws unless modulus is odd and positive
+    explicit MontgomeryContext(const BigInteger &modulus);
+
+    // base^exponent mod m with a fixed window, a fixed sequence of
+    // operations and table reads that touch every entry. The conversions
+    // into and out of Montgomery form go through the same schoolbook
+    // products and masked reductions, so the time taken depends on the
+    // modulus, the sign of base and the lengths in limbs of base and
+    // exponent, but not on their values. Only trimming the high zero limbs
+    // of the result depends on the result.
+    [[nodiscard]] BigInteger powConstantTime(const BigInteger &base, const BigInteger &exponent) const;
+
+protected:
+    void toElement(uint64_t *r, const BigInteger &x) const override;
+
+    [[nodiscard]] BigInteger fromElement(const uint64_t *a) const override;
+
+    void mulmod(uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t *scratch) const override;
+
+    void sqrmod(uint64_t *r, const uint64_t *a, uint64_t *scratch) const override;
+
+private:
+    uint64_t negInverse;             // -m^-1 mod 2^64
+    std::vector<uint64_t> rSquared;  // R^2 mod m
+
+    // r = t R^-1 mod m for t[0..2n) < m R; t is destroyed
+    void redc(uint64_t *r, uint64_t *t) const;
+};
+
+// Barrett reduction for any positive modulus: with mu = floor(2^(128 n) / m)
+// precomputed, a product is reduced by two multiplications and at most two
+// subtractions.
+class BarrettContext : public ModularContext {
+public:
+    // Throws unless modulus is positive
+    explicit BarrettContext(const BigInteger &modulus);
+
+protected:
+    void toElement(uint64_t *r, const BigInteger &x) const override;
+
+    [[nodiscard]] BigInteger fromElement(const uint64_t *a) const override;
+
+    void mulmod(uint64_t *r, const uint64_t *a, const uint64_t *b, uint64_t *scratch) const override;
+
+    void sqrmod(uint64_t *r, const uint64_t *a, uint64_t *scratch) const override;
+
+private:
+    std::vector<uint64_t> mu;
+
+    // r = t mod m for t[0..2n) < m^2; t is destroyed
+    void reduceProduct(uint64_t *r, uint64_t *t, uint64_t *scratch) const;
+};
+
+// base^exponent mod modulus through a Montgomery context for odd moduli and
+// a Barrett one otherwise. Throws for a negative exponent or a modulus that
+// is not positive.
+BigInteger powMod(const BigInteger &base, const BigInteger &exponent, const BigInteger &modulus);
+
+// The constant-time variant of powMod(); the modulus must be odd
+BigInteger powModConstantTime(const BigInteger &base, const BigInteger &exponent, const BigInteger &modulus);
+
+#endif //BIGINTEGER_MODULAR_H
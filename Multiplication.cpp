@@ -0,0 +1,461 @@
+#include "LimbArithmetic.h"
+#include "Instrumentation.h"
+
+#include <algorithm>
+#include <initializer_list>
+
+namespace limbs {
+
+namespace {
+    // Operand sizes, in limbs, at which each algorithm starts to beat the one below it
+    constexpr size_t KARATSUBA_THRESHOLD = 32;
+    constexpr size_t TOOM3_THRESHOLD = 192;
+    constexpr size_t TOOM4_THRESHOLD = 400;
+    constexpr size_t FFT_THRESHOLD = 3000;
+    constexpr size_t FFT_SQR_THRESHOLD = 7000;
+
+    // Squares stay in the cheaper basecase longer; at least KARATSUBA_THRESHOLD,
+    // so karatsuba_scratch() also covers karatsuba_sqr()
+    constexpr size_t SQR_KARATSUBA_THRESHOLD = 80;
+
+    // Most pieces an unbalanced product is cut into for the thread pool
+    constexpr size_t PARALLEL_SLICE_GROUPS = 32;
+
+    void mul_n_recursive(limb_t *r, const limb_t *a, const limb_t *b, size_t n, limb_t *scratch);
+
+    void sqr_recursive(limb_t *r, const limb_t *a, size_t n, limb_t *scratch);
+
+    // Workspace needed by karatsuba() for n-limb operands
+    size_t karatsuba_scratch(size_t n) {
+        if (n < KARATSUBA_THRESHOLD || n >= TOOM3_THRESHOLD) return 0;
+        size_t high = n - n / 2;
+        return std::max(6 * high + 1, 4 * high + karatsuba_scratch(high));
+    }
+
+    // r[0..xn) = |x - y| for xn >= yn, returns true when x < y
+    bool abs_diff(limb_t *r, const limb_t *x, size_t xn, const limb_t *y, size_t yn) {
+        if (normalized_size(x, xn) > yn || cmp(x, y, yn) >= 0) {
+            sub(r, x, xn, y, yn);
+            return false;
+        }
+        sub_n(r, y, x, yn);
+        std::fill(r + yn, r + xn, 0);
+        return true;
+    }
+
+    // Subtractive Karatsuba: with x = x1 B^m + x0, the middle coefficient is
+    // x0 y0 + x1 y1 - (x1 - x0)(y1 - y0), so three half-size products suffice.
+    void karatsuba(limb_t *r, const limb_t *a, const limb_t *b, size_t n, limb_t *scratch) {
+        size_t low = n / 2, high = n - low;
+        limb_t *da = scratch, *db = scratch + high, *t = scratch + 2 * high, *next = scratch + 4 * high;
+
+        bool negative = abs_diff(da, a + low, high, a, low) != abs_diff(db, b + low, high, b, low);
+        mul_n_recursive(t, da, db, high, next);
+        mul_n_recursive(r, a, b, low, next);
+        mul_n_recursive(r + 2 * low, a + low, b + low, high, next);
+
+        limb_t *middle = next;
+        std::copy(r + 2 * low, r + 2 * n, middle);
+        middle[2 * high] = add(middle, middle, 2 * high, r, 2 * low);
+        if (negative) add(middle, middle, 2 * high + 1, t, 2 * high);
+        else sub(middle, middle, 2 * high + 1, t, 2 * high);
+        add(r + low, r + low, 2 * n - low, middle, normalized_size(middle, 2 * high + 1));
+    }
+
+    // Karatsuba for squares: the middle coefficient is x0^2 + x1^2 - (x1 - x0)^2,
+    // and all three half-size products are squares themselves
+    void karatsuba_sqr(limb_t *r, const limb_t *a, size_t n, limb_t *scratch) {
+        size_t low = n / 2, high = n - low;
+        limb_t *da = scratch, *t = scratch + 2 * high, *next = scratch + 4 * high;
+
+        abs_diff(da, a + low, high, a, low);
+        sqr_recursive(t, da, high, next);
+        sqr_recursive(r, a, low, next);
+        sqr_recursive(r + 2 * low, a + low, high, next);
+
+        limb_t *middle = next;
+        std::copy(r + 2 * low, r + 2 * n, middle);
+        middle[2 * high] = add(middle, middle, 2 * high, r, 2 * low);
+        sub(middle, middle, 2 * high + 1, t, 2 * high);
+        add(r + low, r + low, 2 * n - low, middle, normalized_size(middle, 2 * high + 1));
+    }
+
+    // Sign-magnitude scratch value for Toom-Cook evaluation and interpolation,
+    // where intermediate values may go negative
+    struct SignedLimbs {
+        scratch_vector magnitude;
+        bool negative = false;
+
+        SignedLimbs() : magnitude(scratch_resource()) {}
+
+        SignedLimbs(const limb_t *a, size_t n) : magnitude(a, a + normalized_size(a, n), scratch_resource()) {}
+
+        // Copies stay in the scratch pool rather than the default resource
+        SignedLimbs(const SignedLimbs &other) : magnitude(other.magnitude, scratch_resource()), negative(other.negative) {}
+
+        SignedLimbs(SignedLimbs &&other) = default;
+
+        SignedLimbs &operator=(const SignedLimbs &other) = default;
+
+        SignedLimbs &operator=(SignedLimbs &&other) = default;
+
+        void trim() {
+            magnitude.resize(normalized_size(magnitude.data(), magnitude.size()));
+            if (magnitude.empty()) negative = false;
+        }
+    };
+
+    // x += y, or x -= y when subtract is set
+    void accumulate(SignedLimbs &x, const SignedLimbs &y, bool subtract = false) {
+        bool yNegative = y.negative != subtract;
+        size_t xn = x.magnitude.size(), yn = y.magnitude.size();
+        if (yn == 0) return;
+        if (x.negative == yNegative || xn == 0) {
+            x.negative = yNegative;
+            x.magnitude.resize(std::max(xn, yn) + 1);
+            limb_t *r = x.magnitude.data();
+            if (xn >= yn) r[xn] = add(r, r, xn, y.magnitude.data(), yn);
+            else r[yn] = add(r, y.magnitude.data(), yn, r, xn);
+        } else if (xn > yn || (xn == yn && cmp(x.magnitude.data(), y.magnitude.data(), xn) >= 0)) {
+            sub(x.magnitude.data(), x.magnitude.data(), xn, y.magnitude.data(), yn);
+        } else {
+            x.magnitude.resize(yn);
+            sub(x.magnitude.data(), y.magnitude.data(), yn, x.magnitude.data(), xn);
+            x.negative = yNegative;
+        }
+        x.trim();
+    }
+
+    SignedLimbs sum(const SignedLimbs &x, const SignedLimbs &y, bool subtract = false) {
+        SignedLimbs result = x;
+        accumulate(result, y, subtract);
+        return result;
+    }
+
+    // x = x * 2^bits for bits < LIMB_BITS
+    void shift_up(SignedLimbs &x, unsigned bits) {
+        if (x.magnitude.empty()) return;
+        limb_t out = lshift(x.magnitude.data(), x.magnitude.data(), x.magnitude.size(), bits);
+        if (out) x.magnitude.push_back(out);
+    }
+
+    // x = x / 2^bits for bits < LIMB_BITS, the division being exact
+    void shift_down(SignedLimbs &x, unsigned bits) {
+        rshift(x.magnitude.data(), x.magnitude.data(), x.magnitude.size(), bits);
+        x.trim();
+    }
+
+    void multiply_small(SignedLimbs &x, limb_t factor) {
+        if (x.magnitude.empty()) return;
+        limb_t out = mul_1(x.magnitude.data(), x.magnitude.data(), x.magnitude.size(), factor);
+        if (out) x.magnitude.push_back(out);
+    }
+
+    void divide_exact(SignedLimbs &x, limb_t divisor) {
+        divexact_1(x.magnitude.data(), x.magnitude.data(), x.magnitude.size(), divisor);
+        x.trim();
+    }
+
+    struct Product {
+        SignedLimbs &result;
+        const SignedLimbs &x, &y;
+    };
+
+    // Computes every result = x * y, spreading the products over the pool
+    // when parallel is set. The results are sized up front on this thread,
+    // so the tasks only write into them. x and y being the same object makes
+    // the product a square.
+    void multiply_all(std::initializer_list<Product> products, bool parallel) {
+        for (const Product &p: products) {
+            size_t xn = p.x.magnitude.size(), yn = p.y.magnitude.size();
+            p.result.magnitude.assign(xn == 0 || yn == 0 ? 0 : xn + yn, 0);
+            p.result.negative = p.x.negative != p.y.negative;
+        }
+        const Product *list = products.begin();
+        parallel_for(parallel, products.size(), [list](size_t i) {
+            const Product &p = list[i];
+            size_t xn = p.x.magnitude.size(), yn = p.y.magnitude.size();
+            if (p.result.magnitude.empty()) return;
+            if (&p.x == &p.y) sqr(p.result.magnitude.data(), p.x.magnitude.data(), xn);
+            else if (xn >= yn) mul(p.result.magnitude.data(), p.x.magnitude.data(), xn, p.y.magnitude.data(), yn);
+            else mul(p.result.magnitude.data(), p.y.magnitude.data(), yn, p.x.magnitude.data(), xn);
+        });
+        for (const Product &p: products) p.result.trim();
+    }
+
+    // Splits a[0..n) into count pieces of size k, the last one taking what is left
+    std::pmr::vector<SignedLimbs> split(const limb_t *a, size_t n, size_t k, size_t count) {
+        std::pmr::vector<SignedLimbs> parts(scratch_resource());
+        for (size_t i = 0; i < count; ++i) {
+            size_t offset = i * k;
+            parts.emplace_back(a + offset, i + 1 == count ? n - offset : k);
+        }
+        return parts;
+    }
+
+    // r[0..2n) = sum of coefficients[i] * B^(i k); every coefficient is non-negative
+    void recompose(limb_t *r, size_t n, size_t k, const std::pmr::vector<SignedLimbs> &coefficients) {
+        std::fill(r, r + 2 * n, 0);
+        for (size_t i = 0; i < coefficients.size(); ++i) {
+            const scratch_vector &c = coefficients[i].magnitude;
+            if (c.empty()) continue;
+            size_t offset = i * k;
+            add(r + offset, r + offset, 2 * n - offset, c.data(), c.size());
+        }
+    }
+
+    // Toom-3: split into three pieces, evaluate at 0, 1, -1, 2 and infinity,
+    // multiply pointwise and interpolate back. a == b squares, evaluating once.
+    void toom3(limb_t *r, const limb_t *a, const limb_t *b, size_t n) {
+        size_t k = (n + 2) / 3;
+        bool square = a == b;
+        std::pmr::vector<SignedLimbs> x = split(a, n, k, 3), yParts(scratch_resource());
+        if (!square) yParts = split(b, n, k, 3);
+        const std::pmr::vector<SignedLimbs> &y = square ? x : yParts;
+
+        auto evaluate = [](const std::pmr::vector<SignedLimbs> &p, SignedLimbs &at1, SignedLimbs &atMinus1, SignedLimbs &at2) {
+            SignedLimbs even = sum(p[0], p[2]);
+            at1 = sum(even, p[1]);
+            atMinus1 = sum(even, p[1], true);
+            at2 = p[2];
+            shift_up(at2, 1);
+            accumulate(at2, p[1]);
+            shift_up(at2, 1);
+            accumulate(at2, p[0]);
+        };
+        SignedLimbs x1, xm1, x2, yValues[3];
+        evaluate(x, x1, xm1, x2);
+        if (!square) evaluate(y, yValues[0], yValues[1], yValues[2]);
+        const SignedLimbs &y1 = square ? x1 : yValues[0], &ym1 = square ? xm1 : yValues[1],
+                &y2 = square ? x2 : yValues[2];
+
+        SignedLimbs w0, w1, wm1, w2, wInf;
+        multiply_all({{w0, x[0], y[0]}, {w1, x1, y1}, {wm1, xm1, ym1}, {w2, x2, y2}, {wInf, x[2], y[2]}},
+                     use_parallel(n));
+
+        // c2 = (w1 + w(-1))/2 - c0 - c4, c1 + c3 = (w1 - w(-1))/2,
+        // 3 c3 = (w2 - c0 - 4 c2 - 16 c4)/2 - (c1 + c3)
+        std::pmr::vector<SignedLimbs> c(5, scratch_resource());
+        c[0] = w0;
+        c[4] = wInf;
+        c[2] = sum(w1, wm1);
+        shift_down(c[2], 1);
+        accumulate(c[2], w0, true);
+        accumulate(c[2], wInf, true);
+        SignedLimbs odd = sum(w1, wm1, true);
+        shift_down(odd, 1);
+        c[3] = sum(w2, w0, true);
+        SignedLimbs term = c[2];
+        shift_up(term, 2);
+        accumulate(c[3], term, true);
+        term = wInf;
+        shift_up(term, 4);
+        accumulate(c[3], term, true);
+        shift_down(c[3], 1);
+        accumulate(c[3], odd, true);
+        divide_exact(c[3], 3);
+        c[1] = sum(odd, c[3], true);
+        recompose(r, n, k, c);
+    }
+
+    // Toom-4: split into four pieces, evaluate at 0, 1, -1, 2, -2, 1/2 and
+    // infinity, multiply pointwise and interpolate back. a == b squares.
+    void toom4(limb_t *r, const limb_t *a, const limb_t *b, size_t n) {
+        size_t k = (n + 3) / 4;
+        bool square = a == b;
+        std::pmr::vector<SignedLimbs> x = split(a, n, k, 4), yParts(scratch_resource());
+        if (!square) yParts = split(b, n, k, 4);
+        const std::pmr::vector<SignedLimbs> &y = square ? x : yParts;
+
+        // Values at 1, -1, 2, -2 and 8 p(1/2) = 8 p0 + 4 p1 + 2 p2 + p3
+        auto evaluate = [](const std::pmr::vector<SignedLimbs> &p, std::pmr::vector<SignedLimbs> &v) {
+            SignedLimbs even = sum(p[0], p[2]), odd = sum(p[1], p[3]);
+            v.push_back(sum(even, odd));
+            v.push_back(sum(even, odd, true));
+            SignedLimbs term = p[2];
+            shift_up(term, 2);
+            even = sum(p[0], term);
+            term = p[3];
+            shift_up(term, 2);
+            odd = sum(p[1], term);
+            shift_up(odd, 1);
+            v.push_back(sum(even, odd));
+            v.push_back(sum(even, odd, true));
+            SignedLimbs half = p[0];
+            for (size_t i = 1; i < 4; ++i) {
+                shift_up(half, 1);
+                accumulate(half, p[i]);
+            }
+            v.push_back(half);
+        };
+        std::pmr::vector<SignedLimbs> xv(scratch_resource()), yValues(scratch_resource());
+        evaluate(x, xv);
+        if (!square) evaluate(y, yValues);
+        const std::pmr::vector<SignedLimbs> &yv = square ? xv : yValues;
+
+        SignedLimbs w0, wInf, w1, wm1, w2, wm2, wHalf;
+        multiply_all({{w0, x[0], y[0]}, {wInf, x[3], y[3]}, {w1, xv[0], yv[0]}, {wm1, xv[1], yv[1]},
+                      {w2, xv[2], yv[2]}, {wm2, xv[3], yv[3]}, {wHalf, xv[4], yv[4]}}, use_parallel(n));
+
+        std::pmr::vector<SignedLimbs> c(7, scratch_resource());
+        c[0] = w0;
+        c[6] = wInf;
+
+        // Even coefficients: c2 + c4 = (w1 + w(-1))/2 - c0 - c6 and
+        // c2 + 4 c4 = ((w2 + w(-2))/2 - c0 - 64 c6)/4
+        SignedLimbs sixtyFourInf = wInf;
+        shift_up(sixtyFourInf, 6);
+        SignedLimbs evenLow = sum(w1, wm1);
+        shift_down(evenLow, 1);
+        accumulate(evenLow, w0, true);
+        accumulate(evenLow, wInf, true);
+        SignedLimbs evenHigh = sum(w2, wm2);
+        shift_down(evenHigh, 1);
+        accumulate(evenHigh, w0, true);
+        accumulate(evenHigh, sixtyFourInf, true);
+        shift_down(evenHigh, 2);
+        c[4] = sum(evenHigh, evenLow, true);
+        divide_exact(c[4], 3);
+        c[2] = sum(evenLow, c[4], true);
+
+        // Odd coefficients from c1 + c3 + c5, c1 + 4 c3 + 16 c5 and 16 c1 + 4 c3 + c5
+        SignedLimbs oddLow = sum(w1, wm1, true);
+        shift_down(oddLow, 1);
+        SignedLimbs oddHigh = sum(w2, wm2, true);
+        shift_down(oddHigh, 2);
+        SignedLimbs reversed = wHalf, term = w0;
+        shift_up(term, 6);
+        accumulate(reversed, term, true);
+        term = c[2];
+        shift_up(term, 4);
+        accumulate(reversed, term, true);
+        term = c[4];
+        shift_up(term, 2);
+        accumulate(reversed, term, true);
+        accumulate(reversed, wInf, true);
+        shift_down(reversed, 1);
+
+        SignedLimbs high = sum(oddHigh, oddLow, true);    // 3 c3 + 15 c5
+        divide_exact(high, 3);
+        SignedLimbs low = sum(reversed, oddLow, true);    // 15 c1 + 3 c3
+        divide_exact(low, 3);
+        c[3] = oddLow;
+        multiply_small(c[3], 5);
+        accumulate(c[3], high, true);
+        accumulate(c[3], low, true);
+        divide_exact(c[3], 3);
+        c[5] = sum(high, c[3], true);
+        divide_exact(c[5], 5);
+        c[1] = sum(low, c[3], true);
+        divide_exact(c[1], 5);
+        recompose(r, n, k, c);
+    }
+
+    void mul_n_recursive(limb_t *r, const limb_t *a, const limb_t *b, size_t n, limb_t *scratch) {
+        if (n < KARATSUBA_THRESHOLD) mul_basecase(r, a, n, b, n);
+        else if (n < TOOM3_THRESHOLD) karatsuba(r, a, b, n, scratch);
+        else if (n < TOOM4_THRESHOLD) toom3(r, a, b, n);
+        else if (n < FFT_THRESHOLD) toom4(r, a, b, n);
+        else mul_fft(r, a, n, b, n);
+    }
+
+    void sqr_recursive(limb_t *r, const limb_t *a, size_t n, limb_t *scratch) {
+        if (n < SQR_KARATSUBA_THRESHOLD) sqr_basecase(r, a, n);
+        else if (n < TOOM3_THRESHOLD) karatsuba_sqr(r, a, n, scratch);
+        else if (n < TOOM4_THRESHOLD) toom3(r, a, a, n);
+        else if (n < FFT_SQR_THRESHOLD) toom4(r, a, a, n);
+        else sqr_fft(r, a, n);
+    }
+
+    // The algorithms mul_n_recursive() and sqr_recursive() start with
+    instrumentation::Algorithm mul_n_algorithm(size_t n) {
+        using instrumentation::Algorithm;
+        if (n < KARATSUBA_THRESHOLD) return Algorithm::MultiplyBasecase;
+        if (n < TOOM3_THRESHOLD) return Algorithm::MultiplyKaratsuba;
+        if (n < TOOM4_THRESHOLD) return Algorithm::MultiplyToom3;
+        if (n < FFT_THRESHOLD) return Algorithm::MultiplyToom4;
+        return Algorithm::MultiplyFFT;
+    }
+
+    instrumentation::Algorithm sqr_algorithm(size_t n) {
+        using instrumentation::Algorithm;
+        if (n < SQR_KARATSUBA_THRESHOLD) return Algorithm::SquareBasecase;
+        if (n < TOOM3_THRESHOLD) return Algorithm::SquareKaratsuba;
+        if (n < TOOM4_THRESHOLD) return Algorithm::SquareToom3;
+        if (n < FFT_SQR_THRESHOLD) return Algorithm::SquareToom4;
+        return Algorithm::SquareFFT;
+    }
+
+    // Unbalanced operands, KARATSUBA_THRESHOLD <= bn < an: multiply b by
+    // bn-limb slices of a and add the partial products up
+    void mul_slices(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn) {
+        scratch_vector partial(2 * bn, scratch_resource());
+        scratch_vector scratch(karatsuba_scratch(bn), scratch_resource());
+        std::fill(r, r + an + bn, 0);
+        size_t offset = 0;
+        for (; offset + bn <= an; offset += bn) {
+            mul_n_recursive(partial.data(), a + offset, b, bn, scratch.data());
+            add(r + offset, r + offset, an + bn - offset, partial.data(), 2 * bn);
+        }
+        if (offset < an) {
+            size_t rest = an - offset;
+            mul(partial.data(), b, bn, a + offset, rest);
+            add(r + offset, r + offset, bn + rest, partial.data(), bn + rest);
+        }
+    }
+
+    // mul_slices over groups of consecutive slices in parallel, each group
+    // into its own buffer, the groups' products then added up in order
+    void mul_slices_parallel(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn) {
+        size_t slices = an / bn, groups = std::min(slices, PARALLEL_SLICE_GROUPS);
+        auto first = [&](size_t g) { return slices * g / groups * bn; };
+        scratch_vector partials(an + groups * bn, scratch_resource());
+        parallel_for(true, groups, [&](size_t g) {
+            size_t begin = first(g), end = g + 1 == groups ? an : first(g + 1);
+            mul_slices(partials.data() + begin + g * bn, a + begin, end - begin, b, bn);
+        });
+        std::fill(r, r + an + bn, 0);
+        for (size_t g = 0; g < groups; ++g) {
+            size_t begin = first(g), end = g + 1 == groups ? an : first(g + 1);
+            add(r + begin, r + begin, an + bn - begin, partials.data() + begin + g * bn, end - begin + bn);
+        }
+    }
+}
+
+void mul_n(limb_t *r, const limb_t *a, const limb_t *b, size_t n) {
+    if (a == b) {
+        sqr(r, a, n);
+        return;
+    }
+    instrumentation::recordAlgorithm(mul_n_algorithm(n));
+    scratch_vector scratch(karatsuba_scratch(n), scratch_resource());
+    mul_n_recursive(r, a, b, n, scratch.data());
+}
+
+void mul(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn) {
+    if (bn < KARATSUBA_THRESHOLD) {
+        instrumentation::recordAlgorithm(instrumentation::Algorithm::MultiplyBasecase);
+        mul_basecase(r, a, an, b, bn);
+        return;
+    }
+    if (an == bn) {
+        mul_n(r, a, b, bn);
+        return;
+    }
+    if (bn >= FFT_THRESHOLD) {
+        instrumentation::recordAlgorithm(instrumentation::Algorithm::MultiplyFFT);
+        mul_fft(r, a, an, b, bn);
+        return;
+    }
+    instrumentation::recordAlgorithm(instrumentation::Algorithm::MultiplyUnbalanced);
+    if (an >= 2 * bn && use_parallel((an + bn) / 2)) mul_slices_parallel(r, a, an, b, bn);
+    else mul_slices(r, a, an, b, bn);
+}
+
+void sqr(limb_t *r, const limb_t *a, size_t n) {
+    instrumentation::recordAlgorithm(sqr_algorithm(n));
+    scratch_vector scratch(karatsuba_scratch(n), scratch_resource());
+    sqr_recursive(r, a, n, scratch.data());
+}
+
+}
@@ -0,0 +1,295 @@
+#include "LimbArithmetic.h"
+
+#include <algorithm>
+#include <array>
+
+namespace limbs {
+
+namespace {
+    // Transform length from which a parallel transform splits its halves
+    // over the thread pool, and the number of pieces linear passes are cut into
+    constexpr size_t PARALLEL_TRANSFORM_SIZE = size_t(1) << 13;
+    constexpr size_t PARALLEL_CHUNKS = 64;
+
+    // Calls body(begin, end) over [0, n), in pieces spread over the pool when parallel is set
+    void for_chunks(bool parallel, size_t n, const std::function<void(size_t, size_t)> &body) {
+        if (!parallel) {
+            body(0, n);
+            return;
+        }
+        parallel_for(true, PARALLEL_CHUNKS, [&](size_t c) {
+            body(n * c / PARALLEL_CHUNKS, n * (c + 1) / PARALLEL_CHUNKS);
+        });
+    }
+
+    // NTT-friendly prime with its Montgomery constants (R = 2^64). All values
+    // handed to mul() must be below p, or at least one factor must be.
+    struct Modulus {
+        limb_t p;
+        limb_t negInverse;  // -p^-1 mod 2^64
+        limb_t r2;          // R^2 mod p
+        limb_t one;         // R mod p
+        limb_t generator;   // primitive root, in plain form
+
+        // t R^-1 mod p for t < p 2^64, in [0, 2p)
+        limb_t reduceLazy(dlimb_t t) const {
+            limb_t q = static_cast<limb_t>(t) * negInverse;
+            return static_cast<limb_t>((t + static_cast<dlimb_t>(q) * p) >> LIMB_BITS);
+        }
+
+        limb_t reduce(dlimb_t t) const {
+            limb_t r = reduceLazy(t);
+            return r >= p ? r - p : r;
+        }
+
+        limb_t mul(limb_t a, limb_t b) const { return reduce(static_cast<dlimb_t>(a) * b); }
+
+        // Brings a value in [0, 2 bound) down to [0, bound)
+        static limb_t fold(limb_t a, limb_t bound) { return a >= bound ? a - bound : a; }
+
+        limb_t add(limb_t a, limb_t b) const {
+            limb_t s = a + b;
+            return s >= p ? s - p : s;
+        }
+
+        limb_t sub(limb_t a, limb_t b) const { return a >= b ? a - b : a + p - b; }
+
+        // Any 64-bit value into Montgomery form
+        limb_t toMontgomery(limb_t a) const { return mul(a, r2); }
+
+        // base^exponent for base in Montgomery form
+        limb_t pow(limb_t base, limb_t exponent) const {
+            limb_t result = one;
+            for (; exponent; exponent >>= 1) {
+                if (exponent & 1) result = mul(result, base);
+                base = mul(base, base);
+            }
+            return result;
+        }
+
+        // Multiplicative inverse, in and out of Montgomery form
+        limb_t inverse(limb_t a) const { return pow(a, p - 2); }
+    };
+
+    Modulus makeModulus(limb_t p, limb_t generator) {
+        Modulus m{p, 0, 0, 0, generator};
+        limb_t inverse = p;
+        for (int i = 0; i < 5; ++i) inverse *= 2 - p * inverse;
+        m.negInverse = 0 - inverse;
+        m.one = (0 - p) % p;
+        m.r2 = static_cast<limb_t>(static_cast<dlimb_t>(m.one) * m.one % p);
+        return m;
+    }
+
+    // Three primes below 2^62 of the form c 2^k + 1 with k >= 55. Their product
+    // exceeds 2^183.7 > 2^183, which bounds every convolution coefficient of
+    // two limb vectors up to 2^55 limbs long, so the CRT reconstruction is exact.
+    const std::array<Modulus, 3> &moduli() {
+        static const std::array<Modulus, 3> instance = {
+                makeModulus(29ULL * (1ULL << 57) + 1, 3),
+                makeModulus(69ULL * (1ULL << 55) + 1, 5),
+                makeModulus(27ULL * (1ULL << 56) + 1, 5),
+        };
+        return instance;
+    }
+
+    // roots[len + j] = w^j for the primitive (2 len)-th root of unity w, for
+    // every power of two len < n, in Montgomery form
+    scratch_vector rootTable(const Modulus &m, size_t n, bool inverse) {
+        scratch_vector roots(n, scratch_resource());
+        limb_t generator = m.toMontgomery(m.generator);
+        if (inverse) generator = m.inverse(generator);
+        for (size_t len = 1; len < n; len <<= 1) {
+            limb_t w = m.pow(generator, (m.p - 1) / (2 * len));
+            roots[len] = m.one;
+            for (size_t j = 1; j < len; ++j) roots[len + j] = m.mul(roots[len + j - 1], w);
+        }
+        return roots;
+    }
+
+    // Butterflies keep values lazily reduced in [0, 2p); with p < 2^62 the
+    // intermediate sums stay below 4p < 2^64 and every product below p 2^64.
+
+    // Decimation in frequency: natural order in, bit-reversed order out
+    void forward(limb_t *a, size_t n, const scratch_vector &roots, const Modulus &m) {
+        const limb_t twoP = 2 * m.p;
+        for (size_t len = n / 2; len >= 1; len >>= 1) {
+            const limb_t *w = roots.data() + len;
+            for (size_t i = 0; i < n; i += 2 * len) {
+                for (size_t j = 0; j < len; ++j) {
+                    limb_t u = a[i + j], v = a[i + j + len];
+                    a[i + j] = Modulus::fold(u + v, twoP);
+                    a[i + j + len] = m.reduceLazy(static_cast<dlimb_t>(u + twoP - v) * w[j]);
+                }
+            }
+        }
+    }
+
+    // The parallel transforms run the top level as one pass split over the
+    // pool, then the two independent half-size transforms side by side
+    void forward(limb_t *a, size_t n, const scratch_vector &roots, const Modulus &m, bool parallel) {
+        if (!parallel || n < PARALLEL_TRANSFORM_SIZE) {
+            forward(a, n, roots, m);
+            return;
+        }
+        const limb_t twoP = 2 * m.p;
+        size_t half = n / 2;
+        const limb_t *w = roots.data() + half;
+        for_chunks(true, half, [&](size_t begin, size_t end) {
+            for (size_t j = begin; j < end; ++j) {
+                limb_t u = a[j], v = a[j + half];
+                a[j] = Modulus::fold(u + v, twoP);
+                a[j + half] = m.reduceLazy(static_cast<dlimb_t>(u + twoP - v) * w[j]);
+            }
+        });
+        parallel_for(true, 2, [&](size_t i) { forward(a + i * half, half, roots, m, true); });
+    }
+
+    // Decimation in time with inverse roots: bit-reversed order in, natural
+    // order out, scaled by n
+    void backward(limb_t *a, size_t n, const scratch_vector &roots, const Modulus &m) {
+        const limb_t twoP = 2 * m.p;
+        for (size_t len = 1; len < n; len <<= 1) {
+            const limb_t *w = roots.data() + len;
+            for (size_t i = 0; i < n; i += 2 * len) {
+                for (size_t j = 0; j < len; ++j) {
+                    limb_t u = a[i + j], v = m.reduceLazy(static_cast<dlimb_t>(a[i + j + len]) * w[j]);
+                    a[i + j] = Modulus::fold(u + v, twoP);
+                    a[i + j + len] = Modulus::fold(u + twoP - v, twoP);
+                }
+            }
+        }
+    }
+
+    void backward(limb_t *a, size_t n, const scratch_vector &roots, const Modulus &m, bool parallel) {
+        if (!parallel || n < PARALLEL_TRANSFORM_SIZE) {
+            backward(a, n, roots, m);
+            return;
+        }
+        const limb_t twoP = 2 * m.p;
+        size_t half = n / 2;
+        parallel_for(true, 2, [&](size_t i) { backward(a + i * half, half, roots, m, true); });
+        const limb_t *w = roots.data() + half;
+        for_chunks(true, half, [&](size_t begin, size_t end) {
+            for (size_t j = begin; j < end; ++j) {
+                limb_t u = a[j], v = m.reduceLazy(static_cast<dlimb_t>(a[j + half]) * w[j]);
+                a[j] = Modulus::fold(u + v, twoP);
+                a[j + half] = Modulus::fold(u + twoP - v, twoP);
+            }
+        });
+    }
+
+    // Cyclic convolution of a and b modulo m, left in plain form in fa[0..n).
+    // b == nullptr squares a.
+    void convolve(limb_t *fa, const Modulus &m, size_t n, const limb_t *a, size_t an, const limb_t *b, size_t bn,
+                  bool parallel) {
+        scratch_vector roots = rootTable(m, n, false);
+        scratch_vector fb(b == nullptr ? 0 : n, 0, scratch_resource());
+        auto load = [&](limb_t *f, const limb_t *x, size_t xn) {
+            for_chunks(parallel, n, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) f[i] = i < xn ? m.toMontgomery(x[i]) : 0;
+            });
+            forward(f, n, roots, m, parallel);
+        };
+        if (b == nullptr) {
+            load(fa, a, an);
+            for_chunks(parallel, n, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) fa[i] = m.reduceLazy(static_cast<dlimb_t>(fa[i]) * fa[i]);
+            });
+        } else {
+            parallel_for(parallel, 2, [&](size_t i) {
+                if (i == 0) load(fa, a, an);
+                else load(fb.data(), b, bn);
+            });
+            for_chunks(parallel, n, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) fa[i] = m.reduceLazy(static_cast<dlimb_t>(fa[i]) * fb[i]);
+            });
+        }
+        backward(fa, n, rootTable(m, n, true), m, parallel);
+        // Multiplying by the plain n^-1 both undoes the scaling and leaves Montgomery form
+        limb_t scale = m.reduce(m.inverse(m.toMontgomery(n)));
+        for_chunks(parallel, n, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) fa[i] = m.mul(fa[i], scale);
+        });
+    }
+
+    // x = v1 + v2 p1 + v3 p1 p2 for one coefficient, with v1, v2, v3 its
+    // residues in Garner's mixed-radix form
+    struct Garner {
+        const std::array<Modulus, 3> &m;
+        limb_t p1InverseMod2, p1Mod3, p1p2InverseMod3, p1p2Low, p1p2High;
+
+        explicit Garner(const std::array<Modulus, 3> &m) : m(m) {
+            // Constants in Montgomery form, so that m.mul() yields plain products
+            p1InverseMod2 = m[1].inverse(m[1].toMontgomery(m[0].p));
+            p1Mod3 = m[2].toMontgomery(m[0].p);
+            p1p2InverseMod3 = m[2].inverse(m[2].mul(p1Mod3, m[2].toMontgomery(m[1].p)));
+            const dlimb_t p1p2 = static_cast<dlimb_t>(m[0].p) * m[1].p;
+            p1p2Low = static_cast<limb_t>(p1p2);
+            p1p2High = static_cast<limb_t>(p1p2 >> LIMB_BITS);
+        }
+
+        void combine(limb_t *x, limb_t c1, limb_t c2, limb_t c3) const {
+            limb_t v1 = c1;
+            limb_t v2 = m[1].mul(m[1].sub(c2, v1 % m[1].p), p1InverseMod2);
+            limb_t partial = m[2].add(v1 % m[2].p, m[2].mul(v2, p1Mod3));
+            limb_t v3 = m[2].mul(m[2].sub(c3, partial), p1p2InverseMod3);
+
+            dlimb_t low = static_cast<dlimb_t>(v2) * m[0].p + v1;
+            dlimb_t top = static_cast<dlimb_t>(v3) * p1p2Low;
+            x[0] = static_cast<limb_t>(low);
+            dlimb_t middle = (low >> LIMB_BITS) + (top >> LIMB_BITS) + static_cast<dlimb_t>(v3) * p1p2High;
+            x[0] += static_cast<limb_t>(top);
+            middle += x[0] < static_cast<limb_t>(top);
+            x[1] = static_cast<limb_t>(middle);
+            x[2] = static_cast<limb_t>(middle >> LIMB_BITS);
+        }
+    };
+
+    void multiply(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn) {
+        size_t resultSize = an + (b == nullptr ? an : bn);
+        size_t n = 1;
+        while (n < resultSize - 1) n <<= 1;
+        bool parallel = use_parallel(resultSize / 2);
+
+        const std::array<Modulus, 3> &m = moduli();
+        scratch_vector residues(3 * n, scratch_resource());
+        parallel_for(parallel, 3, [&](size_t i) {
+            convolve(residues.data() + i * n, m[i], n, a, an, b, bn, parallel);
+        });
+        const limb_t *c1 = residues.data(), *c2 = c1 + n, *c3 = c2 + n;
+        const Garner garner(m);
+
+        // Each piece of the result is summed with its own running carry;
+        // the carries out of the pieces are added in afterwards, in order
+        size_t pieces = parallel ? PARALLEL_CHUNKS : 1;
+        scratch_vector carries(3 * pieces, scratch_resource());
+        parallel_for(parallel, pieces, [&](size_t piece) {
+            size_t begin = resultSize * piece / pieces, end = resultSize * (piece + 1) / pieces;
+            limb_t *carry = carries.data() + 3 * piece;
+            for (size_t k = begin; k < end; ++k) {
+                limb_t x[3] = {0, 0, 0};
+                if (k < resultSize - 1) garner.combine(x, c1[k], c2[k], c3[k]);
+                limb_t overflow = add_n(x, x, carry, 3);
+                r[k] = x[0];
+                carry[0] = x[1];
+                carry[1] = x[2];
+                carry[2] = overflow;
+            }
+        });
+        for (size_t piece = 0; piece + 1 < pieces; ++piece) {
+            size_t end = resultSize * (piece + 1) / pieces;
+            add(r + end, r + end, resultSize - end, carries.data() + 3 * piece, std::min<size_t>(3, resultSize - end));
+        }
+    }
+}
+
+void mul_fft(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn) {
+    multiply(r, a, an, b, bn);
+}
+
+void sqr_fft(limb_t *r, const limb_t *a, size_t n) {
+    multiply(r, a, n, nullptr, 0);
+}
+
+}
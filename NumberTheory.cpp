@@ -0,0 +1,808 @@
+#include "NumberTheory.h"
+#include "LimbArithmetic.h"
+#include "Modular.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <utility>
+
+using limbs::limb_t;
+using limbs::dlimb_t;
+
+namespace {
+    using sdlimb_t = __int128;
+
+    // Reductions of at least this many bits go through the half-GCD recursion
+    // instead of one Lehmer step after another
+    constexpr size_t HGCD_THRESHOLD_BITS = 64 * 300;
+
+    // Leading bits a Lehmer step looks at; one short of two limbs, so the
+    // leading parts plus cofactors still fit in a dlimb_t
+    constexpr size_t LEHMER_BITS = 2 * limbs::LIMB_BITS - 1;
+
+    // Lehmer cofactors stay below this, so each fits in a limb with its sign apart
+    constexpr sdlimb_t COFACTOR_LIMIT = static_cast<sdlimb_t>(1) << 63;
+
+    // floor(x / y) for y > 0, without a division for the usual small quotients
+    dlimb_t quotient(dlimb_t x, dlimb_t y) {
+        if (x < y) return 0;
+        x -= y;
+        if (x < y) return 1;
+        x -= y;
+        if (x < y) return 2;
+        return 2 + x / y;
+    }
+
+    // r[0..n] = u x[0..n) + v y[0..n) for cofactors of opposite signs. Returns
+    // whether the result is negative, r then holding its magnitude.
+    bool combine(limb_t *r, sdlimb_t u, const limb_t *x, sdlimb_t v, const limb_t *y, size_t n) {
+        if (u < 0 || v > 0) {
+            std::swap(u, v);
+            std::swap(x, y);
+        }
+        r[n] = limbs::mul_1(r, x, n, static_cast<limb_t>(u));
+        limb_t borrow = limbs::submul_1(r, y, n, static_cast<limb_t>(-v));
+        bool negative = r[n] < borrow;
+        r[n] -= borrow;
+        if (negative) {
+            for (size_t i = 0; i <= n; ++i) r[i] = ~r[i];
+            limbs::add_1(r, r, n + 1, 1);
+        }
+        return negative;
+    }
+
+    // Bit i set when i is a square modulo m, for m <= 64
+    constexpr limb_t squaresModulo(limb_t m) {
+        limb_t mask = 0;
+        for (limb_t i = 0; i < m; ++i) mask |= static_cast<limb_t>(1) << (i * i % m);
+        return mask;
+    }
+
+    constexpr limb_t SQUARES_MOD_64 = squaresModulo(64);
+    constexpr limb_t SQUARES_MOD_9 = squaresModulo(9);
+
+    // The odd primes of 2^48 - 1 = 3^2 5 7 13 17 97 241 257 673 apart from 3
+    constexpr limb_t FILTER_PRIMES[] = {5, 7, 13, 17, 97, 241, 257, 673};
+
+    // Whether r is a square modulo the odd prime p, by Euler's criterion
+    bool isQuadraticResidue(limb_t r, limb_t p) {
+        r %= p;
+        if (r == 0) return true;
+        limb_t result = 1;
+        for (limb_t e = (p - 1) / 2; e != 0; e >>= 1) {
+            if (e & 1) result = result * r % p;
+            r = r * r % p;
+        }
+        return result == 1;
+    }
+
+    // floor(sqrt(x)) for 0 <= x < 2^63
+    limb_t wordSqrt(limb_t x) {
+        auto root = static_cast<limb_t>(std::sqrt(static_cast<double>(x)));
+        while (root * root > x) --root;
+        while ((root + 1) * (root + 1) <= x) ++root;
+        return root;
+    }
+
+    // s or s + 1 for s = floor(sqrt(x)), x >= 0. With r from the leading
+    // part, (r + 1) 2^k exceeds sqrt(x) by at most 2^(k+1), and for
+    // k <= (bits - 6) / 4 a single Newton step takes that to within one.
+    BigInteger approximateSqrt(const BigInteger &x) {
+        size_t bits = x.bitLength();
+        if (bits <= 62) return wordSqrt(static_cast<limb_t>(*x.toLongLong()));
+        size_t k = (bits - 6) / 4;
+        BigInteger y = (approximateSqrt(x >> (2 * k)) + 1) << k;
+        y += x / y;
+        y >>= 1;
+        return y;
+    }
+
+    // A value above the k-th root of x, for a root of at most 64 bits, from a
+    // floating-point estimate checked against x
+    BigInteger rootAbove(const BigInteger &x, unsigned k, size_t rootBits) {
+        size_t bits = x.bitLength(), shift = bits > 62 ? bits - 62 : 0;
+        double log2x = std::log2(static_cast<double>(*(x >> shift).toLongLong())) + static_cast<double>(shift);
+        double estimate = std::exp2(log2x / k) * (1 + std::ldexp(1.0, -40)) + 2;
+        if (estimate < std::ldexp(1.0, 64)) {
+            BigInteger y(static_cast<limb_t>(estimate));
+            if (pow(y, k) > x) return y;
+        }
+        return BigInteger::ONE() << rootBits;
+    }
+
+    limb_t wordMagnitude(long long x) {
+        return x < 0 ? 0 - static_cast<limb_t>(x) : static_cast<limb_t>(x);
+    }
+
+    BigInteger toBigInteger(const Integer &x) {
+        return x.usingBigInteger() ? x.asBigInteger() : BigInteger(x.asLongLong());
+    }
+
+    // Odd primes below this are kept for trial division and sieving
+    constexpr uint32_t SMALL_PRIME_LIMIT = 1 << 16;
+
+    // isProbablePrime() trial-divides by the odd primes below this
+    constexpr uint32_t TRIAL_DIVISION_LIMIT = 1024;
+
+    // Odd candidates per segment of primesInRange()
+    constexpr size_t SIEVE_SEGMENT = 1 << 14;
+
+    const std::vector<uint32_t> &oddPrimes() {
+        static const std::vector<uint32_t> primes = [] {
+            std::vector<bool> composite(SMALL_PRIME_LIMIT);
+            std::vector<uint32_t> list;
+            for (uint32_t p = 3; p < SMALL_PRIME_LIMIT; p += 2) {
+                if (composite[p]) continue;
+                list.push_back(p);
+                for (uint32_t q = p * p; q < SMALL_PRIME_LIMIT; q += 2 * p) composite[q] = true;
+            }
+            return list;
+        }();
+        return primes;
+    }
+
+    // Sieving pays off up to primes about this large for candidates of the
+    // given size, as a Miller-Rabin test costs more the longer they are
+    uint32_t sieveLimit(size_t bits) {
+        return static_cast<uint32_t>(std::min<size_t>(SMALL_PRIME_LIMIT, std::max<size_t>(64 * bits, 256)));
+    }
+
+    limb_t powMod(limb_t base, limb_t exponent, limb_t m) {
+        limb_t result = 1;
+        base %= m;
+        for (; exponent != 0; exponent >>= 1) {
+            if (exponent & 1) result = static_cast<dlimb_t>(result) * base % m;
+            base = static_cast<dlimb_t>(base) * base % m;
+        }
+        return result;
+    }
+
+    // Miller-Rabin to bases that no composite below 2^64 passes together
+    bool wordIsPrime(limb_t n) {
+        if (n < 2) return false;
+        for (limb_t p: {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37}) {
+            if (n % p == 0) return n == p;
+        }
+        if (n < 41 * 41) return true;
+        limb_t d = n - 1;
+        int s = __builtin_ctzll(d);
+        d >>= s;
+        for (limb_t base: {2, 325, 9375, 28178, 450775, 9780504, 1795265022}) {
+            limb_t x = powMod(base, d, n);
+            if (x == 0 || x == 1 || x == n - 1) continue;
+            int i = 1;
+            for (; i < s; ++i) {
+                x = static_cast<dlimb_t>(x) * x % n;
+                if (x == n - 1) break;
+            }
+            if (i == s) return false;
+        }
+        return true;
+    }
+
+    // Jacobi symbol (a / m) for odd m > 0
+    int wordJacobi(limb_t a, limb_t m) {
+        a %= m;
+        int result = 1;
+        while (a != 0) {
+            while (a % 2 == 0) {
+                a /= 2;
+                if (m % 8 == 3 || m % 8 == 5) result = -result;
+            }
+            std::swap(a, m);
+            if (a % 4 == 3 && m % 4 == 3) result = -result;
+            a %= m;
+        }
+        return m == 1 ? result : 0;
+    }
+
+    // Per-thread source of Miller-Rabin bases
+    std::mt19937_64 &randomEngine() {
+        thread_local std::mt19937_64 engine(std::random_device{}());
+        return engine;
+    }
+}
+
+// Euclid's algorithm and its relatives, square roots and primality tests, on
+// BigInteger's limbs
+class NumberTheory {
+public:
+    // Integer matrix of determinant +-1; it takes a pair (a, b) to R (a, b)
+    struct Matrix {
+        BigInteger m[2][2] = {{1, 0}, {0, 1}};
+
+        // *this = left * *this
+        void multiplyLeft(const Matrix &left) {
+            Matrix product;
+            for (int i = 0; i < 2; ++i) {
+                for (int j = 0; j < 2; ++j) {
+                    product.m[i][j] = left.m[i][0] * m[0][j];
+                    addmul(product.m[i][j], left.m[i][1], m[1][j]);
+                }
+            }
+            *this = std::move(product);
+        }
+
+        void swapRows() {
+            std::swap(m[0][0], m[1][0]);
+            std::swap(m[0][1], m[1][1]);
+        }
+
+        void negateRow(int row) {
+            for (BigInteger &entry: m[row]) {
+                if (!entry.data.empty()) entry.negative = !entry.negative;
+            }
+        }
+    };
+
+    // gcd(|a|, |b|); with R, also the matrix taking (|a|, |b|) to (gcd, 0)
+    static BigInteger gcd(BigInteger a, BigInteger b, Matrix *R) {
+        a.negative = b.negative = false;
+        if (a < b) {
+            std::swap(a, b);
+            if (R) R->swapRows();
+        }
+        while (!b.data.empty()) {
+            if (!R && a.data.size() == 1) return BigInteger(limbs::gcd_1(a.data[0], b.data[0]));
+            // Halve a by a half-GCD, then one division step to get past
+            // where it stopped
+            size_t half = a.bitLength() / 2;
+            if (half >= HGCD_THRESHOLD_BITS) {
+                if (b.bitLength() > half) reduce(a, b, half, R);
+                if (!b.data.empty()) divisionStep(a, b, R);
+            } else {
+                lehmerStep(a, b, R);
+            }
+        }
+        return a;
+    }
+
+    // gcd(a, b) and the cofactor x of extendedGcd()
+    static std::pair<BigInteger, BigInteger> gcdCofactor(const BigInteger &a, const BigInteger &b) {
+        Matrix R;
+        BigInteger g = gcd(a, b, &R);
+        if (b.data.empty()) return {g, a.data.empty() ? 0 : (a.negative ? -1 : 1)};
+        BigInteger x = std::move(R.m[0][0]), period = b / g;
+        if (a.negative && !x.data.empty()) x.negative = !x.negative;
+        period.negative = false;
+        x %= period;
+        if (x.negative) x += period;
+        if ((x << 1) > period) x -= period;
+        return {g, x};
+    }
+
+    // False when x > 0 is certainly not a square, from its residues modulo 64,
+    // 9 and the primes of FILTER_PRIMES
+    static bool maybeSquare(const BigInteger &x) {
+        if (!((SQUARES_MOD_64 >> (x.data[0] % 64)) & 1)) return false;
+        limb_t r = residue48(x);
+        if (!((SQUARES_MOD_9 >> (r % 9)) & 1)) return false;
+        for (limb_t p: FILTER_PRIMES) {
+            if (!isQuadraticResidue(r, p)) return false;
+        }
+        return true;
+    }
+
+    static bool isProbablePrime(const BigInteger &n, unsigned rounds, bool bailliePSW) {
+        if (n.negative || n.data.empty()) return false;
+        if (n.data.size() == 1) return wordIsPrime(n.data[0]);
+        if (!n.isOdd() || hasSmallFactor(n)) return false;
+        return probablePrime(n, std::max(rounds, 1u), bailliePSW);
+    }
+
+    // Whether a candidate that came through sieve() is a probable prime
+    static bool sievedProbablePrime(const BigInteger &n, unsigned rounds) {
+        if (n.data.size() == 1) return wordIsPrime(n.data[0]);
+        return probablePrime(n, std::max(rounds, 1u), false);
+    }
+
+    // The offsets i < count for which base + 2 i has no odd prime factor
+    // below limit other than itself; base is odd and positive
+    static std::vector<size_t> sieve(const BigInteger &base, size_t count, uint32_t limit) {
+        const std::vector<uint32_t> &primes = oddPrimes();
+        size_t primeCount = std::lower_bound(primes.begin(), primes.end(), limit) - primes.begin();
+        std::vector<uint32_t> r(primeCount);
+        residues(base, primes.data(), primeCount, r.data());
+        std::optional<long long> small = base.toLongLong();
+        std::vector<bool> composite(count);
+        for (size_t j = 0; j < primeCount; ++j) {
+            limb_t p = primes[j];
+            // base + 2 i = 0 mod p for i = -base / 2 mod p
+            limb_t i = (p - r[j]) % p * ((p + 1) / 2) % p;
+            if (small && static_cast<limb_t>(*small) + 2 * i == p) i += p;
+            for (; i < count; i += p) composite[i] = true;
+        }
+        std::vector<size_t> survivors;
+        for (size_t i = 0; i < count; ++i) {
+            if (!composite[i]) survivors.push_back(i);
+        }
+        return survivors;
+    }
+
+private:
+    // Whether n has an odd prime factor below TRIAL_DIVISION_LIMIT; n must be larger
+    static bool hasSmallFactor(const BigInteger &n) {
+        const std::vector<uint32_t> &primes = oddPrimes();
+        size_t count = std::lower_bound(primes.begin(), primes.end(), TRIAL_DIVISION_LIMIT) - primes.begin();
+        std::vector<uint32_t> r(count);
+        residues(n, primes.data(), count, r.data());
+        return std::find(r.begin(), r.end(), 0) != r.end();
+    }
+
+    // Miller-Rabin for odd n >= 2^64, base 2 first, with a strong Lucas test
+    // after it for bailliePSW
+    static bool probablePrime(const BigInteger &n, unsigned rounds, bool bailliePSW) {
+        MontgomeryContext context(n);
+        BigInteger nMinus1 = n - BigInteger::ONE();
+        size_t s = trailingZeros(nMinus1);
+        BigInteger d = nMinus1 >> s;
+        if (!strongProbablePrime(context, nMinus1, d, s, 2)) return false;
+        if (bailliePSW && !strongLucasProbablePrime(context)) return false;
+        BigInteger range = n - 3;
+        for (unsigned i = 1; i < rounds; ++i) {
+            if (!strongProbablePrime(context, nMinus1, d, s, randomBelow(range) + 2)) return false;
+        }
+        return true;
+    }
+
+    // |x| mod d
+    static limb_t remainder(const BigInteger &x, limb_t d) {
+        dlimb_t r = 0;
+        for (size_t i = x.data.size(); i-- > 0;) r = ((r << limbs::LIMB_BITS) | x.data[i]) % d;
+        return static_cast<limb_t>(r);
+    }
+
+    // r[i] = |x| mod primes[i] for i < count, with one pass over x for each
+    // run of primes whose product fits in a limb
+    static void residues(const BigInteger &x, const uint32_t *primes, size_t count, uint32_t *r) {
+        size_t i = 0;
+        while (i < count) {
+            limb_t product = primes[i];
+            size_t end = i + 1;
+            while (end < count && product <= UINT64_MAX / primes[end]) product *= primes[end++];
+            limb_t rest = remainder(x, product);
+            for (; i < end; ++i) r[i] = static_cast<uint32_t>(rest % primes[i]);
+        }
+    }
+
+    // Number of low zero bits of x != 0
+    static size_t trailingZeros(const BigInteger &x) {
+        size_t i = 0;
+        while (x.data[i] == 0) ++i;
+        return i * limbs::LIMB_BITS + __builtin_ctzll(x.data[i]);
+    }
+
+    // Roughly uniform in [0, bound) for bound > 0
+    static BigInteger randomBelow(const BigInteger &bound) {
+        BigInteger x;
+        x.data.resize(bound.data.size() + 1);
+        for (limb_t &limb: x.data) limb = randomEngine()();
+        x.normalize();
+        return x % bound;
+    }
+
+    // Jacobi symbol (a / n) for odd a and odd n > 0, by reciprocity
+    static int jacobi(long long a, const BigInteger &n) {
+        limb_t magnitude = wordMagnitude(a), low = n.data[0];
+        int sign = 1;
+        if (a < 0 && low % 4 == 3) sign = -sign;
+        if (magnitude % 4 == 3 && low % 4 == 3) sign = -sign;
+        return sign * wordJacobi(remainder(n, magnitude), magnitude);
+    }
+
+    // Strong probable-prime test of the modulus n = d 2^s + 1 of context to base
+    static bool strongProbablePrime(const MontgomeryContext &context, const BigInteger &nMinus1,
+                                    const BigInteger &d, size_t s, const BigInteger &base) {
+        BigInteger x = context.pow(base, d);
+        if (x == BigInteger::ONE() || x == nMinus1) return true;
+        for (size_t i = 1; i < s; ++i) {
+            x = context.multiply(x, x);
+            if (x == nMinus1) return true;
+            if (x == BigInteger::ONE()) return false;
+        }
+        return false;
+    }
+
+    // Strong Lucas probable-prime test of the odd modulus n of context, with
+    // P = 1 and Q = (1 - D) / 4 for the first D of 5, -7, 9, -11, ... with
+    // (D / n) = -1. For n + 1 = d 2^s it checks U_d = 0 or V_(d 2^r) = 0 for
+    // some r < s, taking U, V and Q^k along the bits of d in the Montgomery
+    // representation, where the recurrences only add, halve and multiply.
+    static bool strongLucasProbablePrime(const ModularContext &context) {
+        const BigInteger &n = context.modulus();
+        // No D has (D / n) = -1 when n is a square
+        if (isPerfectSquare(n)) return false;
+        long long D = 5;
+        while (true) {
+            int symbol = jacobi(D, n);
+            if (symbol == -1) break;
+            if (symbol == 0) return false;
+            D = D > 0 ? -D - 2 : -D + 2;
+        }
+        BigInteger d = n + BigInteger::ONE();
+        size_t s = trailingZeros(d);
+        d >>= s;
+
+        size_t k = context.n;
+        const limb_t *m = context.m.data();
+        limbs::scratch_vector buffer(6 * k + context.scratchLimbs, limbs::scratch_resource());
+        limb_t *U = buffer.data(), *V = U + k, *Qk = V + k, *Q = Qk + k, *DU = Q + k, *DElement = DU + k;
+        limb_t *scratch = DElement + k;
+        context.toElement(U, BigInteger::ONE());
+        std::copy(U, U + k, V);
+        context.toElement(Q, BigInteger((1 - D) / 4));
+        std::copy(Q, Q + k, Qk);
+        context.toElement(DElement, BigInteger(D));
+
+        auto addmod = [&](limb_t *r, const limb_t *a, const limb_t *b) {
+            limb_t carry = limbs::add_n(r, a, b, k);
+            if (carry || limbs::cmp(r, m, k) >= 0) limbs::sub_n(r, r, m, k);
+        };
+        auto submod = [&](limb_t *r, const limb_t *a, const limb_t *b) {
+            if (limbs::sub_n(r, a, b, k)) limbs::add_n(r, r, m, k);
+        };
+        auto halve = [&](limb_t *r) {
+            limb_t carry = r[0] & 1 ? limbs::add_n(r, r, m, k) : 0;
+            limbs::rshift(r, r, k, 1);
+            r[k - 1] |= carry << (limbs::LIMB_BITS - 1);
+        };
+        // V_2k = V_k^2 - 2 Q^k, then Q^k becomes Q^2k
+        auto doubleV = [&]() {
+            context.sqrmod(V, V, scratch);
+            submod(V, V, Qk);
+            submod(V, V, Qk);
+            context.sqrmod(Qk, Qk, scratch);
+        };
+        auto isZero = [k](const limb_t *a) { return limbs::normalized_size(a, k) == 0; };
+
+        for (size_t i = d.bitLength() - 1; i-- > 0;) {
+            // U_2k = U_k V_k
+            context.mulmod(U, U, V, scratch);
+            doubleV();
+            if ((d.data[i / limbs::LIMB_BITS] >> (i % limbs::LIMB_BITS)) & 1) {
+                // U_(k+1) = (U_k + V_k) / 2, V_(k+1) = (D U_k + V_k) / 2
+                context.mulmod(DU, DElement, U, scratch);
+                addmod(U, U, V);
+                halve(U);
+                addmod(V, V, DU);
+                halve(V);
+                context.mulmod(Qk, Qk, Q, scratch);
+            }
+        }
+        if (isZero(U) || isZero(V)) return true;
+        for (size_t r = 1; r < s; ++r) {
+            doubleV();
+            if (isZero(V)) return true;
+        }
+        return false;
+    }
+
+    // x mod 2^48 - 1, adding up 48-bit pieces as 2^48 = 1 there; limb i
+    // starts 64 i = 16 (i mod 3) bits into a piece
+    static limb_t residue48(const BigInteger &x) {
+        constexpr limb_t mask = (static_cast<limb_t>(1) << 48) - 1;
+        dlimb_t sum = 0;
+        for (size_t i = 0; i < x.data.size(); ++i) {
+            dlimb_t piece = static_cast<dlimb_t>(x.data[i]) << (16 * (i % 3));
+            sum += (piece & mask) + (piece >> 48);
+        }
+        while (sum > mask) sum = (sum & mask) + (sum >> 48);
+        return sum == mask ? 0 : static_cast<limb_t>(sum);
+    }
+
+    // (a >> shift) mod 2^128
+    static dlimb_t leading(const BigInteger &x, size_t shift) {
+        size_t limb = shift / limbs::LIMB_BITS;
+        unsigned bit = shift % limbs::LIMB_BITS;
+        auto at = [&x](size_t i) -> limb_t { return i < x.data.size() ? x.data[i] : 0; };
+        dlimb_t value = (static_cast<dlimb_t>(at(limb + 1)) << limbs::LIMB_BITS) | at(limb);
+        if (bit) value = (value >> bit) | (static_cast<dlimb_t>(at(limb + 2)) << (2 * limbs::LIMB_BITS - bit));
+        return value;
+    }
+
+    // (a, b) = (b, a mod b) for a >= b > 0
+    static void divisionStep(BigInteger &a, BigInteger &b, Matrix *R) {
+        if (!R) {
+            a %= b;
+            std::swap(a, b);
+            return;
+        }
+        auto [q, r] = a.divmod(b);
+        // (b, a - q b) = [[0, 1], [1, -q]] (a, b)
+        submul(R->m[0][0], q, R->m[1][0]);
+        submul(R->m[0][1], q, R->m[1][1]);
+        R->swapRows();
+        a = std::move(b);
+        b = std::move(r);
+    }
+
+    // One step of Lehmer's algorithm on a >= b > 0: all the quotients that the
+    // leading bits of a and b determine at once, applied to the whole numbers
+    // with single-limb cofactors, or a plain division step if there are none
+    static void lehmerStep(BigInteger &a, BigInteger &b, Matrix *R) {
+        size_t bits = a.bitLength(), shift = bits > LEHMER_BITS ? bits - LEHMER_BITS : 0;
+        dlimb_t x = leading(a, shift), y = leading(b, shift);
+
+        // Knuth's Algorithm L: a quotient is taken only when the bounds on it
+        // from both cofactor pairs agree
+        sdlimb_t A = 1, B = 0, C = 0, D = 1;
+        while (true) {
+            dlimb_t yc = y + static_cast<dlimb_t>(C), yd = y + static_cast<dlimb_t>(D);
+            if (yc == 0 || yd == 0) break;
+            dlimb_t q = quotient(x + static_cast<dlimb_t>(A), yc);
+            if (q != quotient(x + static_cast<dlimb_t>(B), yd) || q >= COFACTOR_LIMIT) break;
+            auto sq = static_cast<sdlimb_t>(q);
+            sdlimb_t nextC = A - sq * C, nextD = B - sq * D;
+            if (nextC <= -COFACTOR_LIMIT || nextC >= COFACTOR_LIMIT
+                || nextD <= -COFACTOR_LIMIT || nextD >= COFACTOR_LIMIT) break;
+            A = C;
+            B = D;
+            C = nextC;
+            D = nextD;
+            dlimb_t remainder = x - q * y;
+            x = y;
+            y = remainder;
+        }
+        if (B == 0) {
+            divisionStep(a, b, R);
+            return;
+        }
+
+        size_t n = a.data.size();
+        limbs::scratch_vector buffer(3 * n + 2, limbs::scratch_resource());
+        limb_t *paddedB = buffer.data(), *nextA = paddedB + n, *nextB = nextA + n + 1;
+        std::copy(b.data.begin(), b.data.end(), paddedB);
+        if (combine(nextA, A, a.data.data(), B, paddedB, n)) {
+            A = -A;
+            B = -B;
+        }
+        if (combine(nextB, C, a.data.data(), D, paddedB, n)) {
+            C = -C;
+            D = -D;
+        }
+        a.data.assign(nextA, nextA + limbs::normalized_size(nextA, n + 1));
+        b.data.assign(nextB, nextB + limbs::normalized_size(nextB, n + 1));
+        a.negative = b.negative = false;
+        bool swapped = a < b;
+        if (swapped) std::swap(a, b);
+        if (R) {
+            Matrix step;
+            step.m[0][0] = static_cast<long long>(A);
+            step.m[0][1] = static_cast<long long>(B);
+            step.m[1][0] = static_cast<long long>(C);
+            step.m[1][1] = static_cast<long long>(D);
+            if (swapped) step.swapRows();
+            R->multiplyLeft(step);
+        }
+    }
+
+    // Takes a >= b > 0 to reduction (a, b) when that shortens a, keeping the
+    // pair non-negative and ordered; returns whether it did
+    static bool applyReduction(BigInteger &a, BigInteger &b, Matrix &reduction, Matrix *R) {
+        BigInteger nextA = reduction.m[0][0] * a, nextB = reduction.m[1][0] * a;
+        addmul(nextA, reduction.m[0][1], b);
+        addmul(nextB, reduction.m[1][1], b);
+        if (nextA.negative) {
+            nextA.negative = false;
+            reduction.negateRow(0);
+        }
+        if (nextB.negative) {
+            nextB.negative = false;
+            reduction.negateRow(1);
+        }
+        if (nextA < nextB) {
+            std::swap(nextA, nextB);
+            reduction.swapRows();
+        }
+        if (nextA.bitLength() >= a.bitLength()) return false;
+        a = std::move(nextA);
+        b = std::move(nextB);
+        if (R) R->multiplyLeft(reduction);
+        return true;
+    }
+
+    // Reduces a >= b > 0 until b has at most s bits. The matrix for the top
+    // 2d bits, d = bits(a) - s, comes from reducing them by d bits
+    // recursively; it is correct for the whole numbers up to the last few
+    // quotients, which the sign and order fix-ups of applyReduction() absorb.
+    // Reductions by more than half of a are done in two halves.
+    static void reduce(BigInteger &a, BigInteger &b, size_t s, Matrix *R) {
+        while (b.bitLength() > s) {
+            size_t bits = a.bitLength(), d = bits - s;
+            if (d < HGCD_THRESHOLD_BITS) {
+                lehmerStep(a, b, R);
+            } else if (2 * s > bits) {
+                size_t p = 2 * s - bits;
+                BigInteger topA = a >> p, topB = b >> p;
+                Matrix top;
+                reduce(topA, topB, s - p, &top);
+                if (!applyReduction(a, b, top, R)) lehmerStep(a, b, R);
+            } else if (b.bitLength() > bits - d / 2) {
+                reduce(a, b, bits - d / 2, R);
+            } else {
+                // b is already short of the first half's target, so the next
+                // quotient is large
+                divisionStep(a, b, R);
+            }
+        }
+    }
+};
+
+BigInteger gcd(const BigInteger &a, const BigInteger &b) {
+    return NumberTheory::gcd(a, b, nullptr);
+}
+
+BigInteger lcm(const BigInteger &a, const BigInteger &b) {
+    if (a == BigInteger::ZERO() || b == BigInteger::ZERO()) return BigInteger::ZERO();
+    BigInteger result = a / gcd(a, b) * b;
+    if (result < BigInteger::ZERO()) return BigInteger::ZERO() - result;
+    return result;
+}
+
+std::tuple<BigInteger, BigInteger, BigInteger> extendedGcd(const BigInteger &a, const BigInteger &b) {
+    auto [g, x] = NumberTheory::gcdCofactor(a, b);
+    if (b == BigInteger::ZERO()) return {g, x, BigInteger::ZERO()};
+    BigInteger y = g;
+    submul(y, a, x);
+    y /= b;
+    return {g, x, y};
+}
+
+BigInteger modInverse(const BigInteger &a, const BigInteger &modulus) {
+    if (modulus <= BigInteger::ZERO()) throw std::runtime_error("Modulus must be positive");
+    auto [g, x] = NumberTheory::gcdCofactor(a, modulus);
+    if (g != BigInteger::ONE()) throw std::runtime_error("Not invertible");
+    if (x < BigInteger::ZERO()) x += modulus;
+    return x;
+}
+
+std::pair<BigInteger, BigInteger> isqrtRem(const BigInteger &x) {
+    if (x < BigInteger::ZERO()) throw std::runtime_error("Square root of a negative number");
+    BigInteger root = approximateSqrt(x), square = root;
+    square *= square;
+    BigInteger remainder = x - std::move(square);
+    if (remainder < BigInteger::ZERO()) {
+        --root;
+        remainder += root;
+        remainder += root;
+        ++remainder;
+    }
+    return {root, remainder};
+}
+
+BigInteger isqrt(const BigInteger &x) {
+    return isqrtRem(x).first;
+}
+
+BigInteger iroot(const BigInteger &x, unsigned k) {
+    if (k == 0) throw std::runtime_error("Zeroth root");
+    if (x < BigInteger::ZERO()) {
+        if (k % 2 == 0) throw std::runtime_error("Even root of a negative number");
+        return BigInteger::ZERO() - iroot(BigInteger::ZERO() - x, k);
+    }
+    if (k == 1) return x;
+    if (k == 2) return isqrt(x);
+    size_t bits = x.bitLength();
+    if (bits <= k) return x == BigInteger::ZERO() ? 0 : 1;
+
+    // Start above the root, from the root of the leading part when the root
+    // is long, then take Newton steps, which decrease until they reach it
+    size_t rootBits = (bits + k - 1) / k;
+    BigInteger y;
+    if (rootBits > limbs::LIMB_BITS) {
+        size_t half = rootBits / 2;
+        y = (iroot(x >> (k * half), k) + 1) << half;
+    } else {
+        y = rootAbove(x, k, rootBits);
+    }
+    while (true) {
+        BigInteger next = x / pow(y, k - 1);
+        addmul(next, y, BigInteger(k - 1));
+        next /= BigInteger(k);
+        if (next >= y) return y;
+        y = std::move(next);
+    }
+}
+
+bool isPerfectSquare(const BigInteger &x) {
+    if (x <= BigInteger::ZERO()) return x == BigInteger::ZERO();
+    return NumberTheory::maybeSquare(x) && isqrtRem(x).second == BigInteger::ZERO();
+}
+
+Integer gcd(const Integer &a, const Integer &b) {
+    if (!a.usingBigInteger() && !b.usingBigInteger()) {
+        return limbs::gcd_1(wordMagnitude(a.asLongLong()), wordMagnitude(b.asLongLong()));
+    }
+    return gcd(toBigInteger(a), toBigInteger(b));
+}
+
+Integer lcm(const Integer &a, const Integer &b) {
+    if (a == 0 || b == 0) return 0;
+    Integer result = a / gcd(a, b) * b;
+    if (result < 0) return Integer(0) - result;
+    return result;
+}
+
+std::tuple<Integer, Integer, Integer> extendedGcd(const Integer &a, const Integer &b) {
+    if (a.usingBigInteger() || b.usingBigInteger()) {
+        auto [g, x, y] = extendedGcd(toBigInteger(a), toBigInteger(b));
+        return {g, x, y};
+    }
+    long long av = a.asLongLong(), bv = b.asLongLong();
+    limb_t r0 = wordMagnitude(av), r1 = wordMagnitude(bv);
+    // Euclid on the magnitudes, keeping the cofactor of |a|
+    sdlimb_t s0 = 1, s1 = 0;
+    while (r1 != 0) {
+        limb_t q = r0 / r1, r = r0 - q * r1;
+        sdlimb_t s = s0 - static_cast<sdlimb_t>(q) * s1;
+        r0 = r1;
+        r1 = r;
+        s0 = s1;
+        s1 = s;
+    }
+    limb_t g = r0;
+    if (bv == 0) return {g, av == 0 ? 0 : (av < 0 ? -1 : 1), 0};
+    sdlimb_t x = av < 0 ? -s0 : s0, period = wordMagnitude(bv) / g;
+    x %= period;
+    if (x < 0) x += period;
+    if (2 * x > period) x -= period;
+    sdlimb_t y = (static_cast<sdlimb_t>(g) - static_cast<sdlimb_t>(av) * x) / bv;
+    return {g, static_cast<long long>(x), static_cast<long long>(y)};
+}
+
+Integer modInverse(const Integer &a, const Integer &modulus) {
+    if (a.usingBigInteger() || modulus.usingBigInteger()) return modInverse(toBigInteger(a), toBigInteger(modulus));
+    if (modulus <= 0) throw std::runtime_error("Modulus must be positive");
+    auto [g, x, y] = extendedGcd(a, modulus);
+    if (g != 1) throw std::runtime_error("Not invertible");
+    if (x < 0) x += modulus;
+    return x;
+}
+
+bool isProbablePrime(const BigInteger &n, unsigned rounds, bool bailliePSW) {
+    return NumberTheory::isProbablePrime(n, rounds, bailliePSW);
+}
+
+BigInteger nextPrime(const BigInteger &n, unsigned rounds) {
+    if (n < BigInteger(2)) return 2;
+    BigInteger base = n + BigInteger::ONE();
+    if (!base.isOdd()) ++base;
+    // Windows a few times the expected gap between primes, ln(n) / 2 odd numbers
+    size_t bits = base.bitLength(), window = std::min<size_t>(std::max<size_t>(bits, 64), SIEVE_SEGMENT);
+    while (true) {
+        for (size_t i: NumberTheory::sieve(base, window, sieveLimit(bits))) {
+            BigInteger candidate = base + BigInteger(static_cast<long long>(2 * i));
+            if (NumberTheory::sievedProbablePrime(candidate, rounds)) return candidate;
+        }
+        base += BigInteger(static_cast<long long>(2 * window));
+        bits = base.bitLength();
+    }
+}
+
+std::vector<BigInteger> primesInRange(const BigInteger &from, const BigInteger &to, unsigned rounds) {
+    std::vector<BigInteger> primes;
+    BigInteger base = std::max(from, BigInteger(2));
+    if (base >= to) return primes;
+    if (base == BigInteger(2)) primes.emplace_back(2);
+    if (!base.isOdd()) ++base;
+    uint32_t limit = sieveLimit(to.bitLength());
+    while (base < to) {
+        // Odd candidates base, base + 2, ... below to, at most one segment of them
+        auto left = (to - base + BigInteger::ONE()) >> 1;
+        size_t count = left < BigInteger(static_cast<long long>(SIEVE_SEGMENT)) ? static_cast<size_t>(*left.toLongLong()) : SIEVE_SEGMENT;
+        std::vector<size_t> survivors = NumberTheory::sieve(base, count, limit);
+        std::vector<BigInteger> candidates;
+        candidates.reserve(survivors.size());
+        for (size_t i: survivors) candidates.push_back(base + BigInteger(static_cast<long long>(2 * i)));
+        std::vector<char> prime(candidates.size());
+        limbs::parallel_for(true, candidates.size(), [&](size_t i) {
+            prime[i] = NumberTheory::sievedProbablePrime(candidates[i], rounds);
+        });
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (prime[i]) primes.push_back(std::move(candidates[i]));
+        }
+        base += BigInteger(static_cast<long long>(2 * count));
+    }
+    return primes;
+}
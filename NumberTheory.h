@@ -0,0 +1,66 @@
+#ifndef BIGINTEGER_NUMBERTHEORY_H
+#define BIGINTEGER_NUMBERTHEORY_H
+
+#include "BigInteger.h"
+#include "Integer.h"
+
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Greatest common divisor, never negative; gcd(0, 0) = 0. Lehmer's algorithm
+// on two-limb leading parts, with a subquadratic half-GCD for huge operands.
+BigInteger gcd(const BigInteger &a, const BigInteger &b);
+
+// Least common multiple, never negative; 0 when either argument is 0
+BigInteger lcm(const BigInteger &a, const BigInteger &b);
+
+// (g, x, y) with a x + b y = g = gcd(a, b). For b != 0, x is the one with
+// -|b|/2g < x <= |b|/2g; for b = 0 it is the sign of a and y is 0.
+std::tuple<BigInteger, BigInteger, BigInteger> extendedGcd(const BigInteger &a, const BigInteger &b);
+
+// x in [0, modulus) with a x = 1 mod modulus; throws when there is none
+BigInteger modInverse(const BigInteger &a, const BigInteger &modulus);
+
+// floor(sqrt(x)) for x >= 0, by Newton iteration on roots of ever longer
+// leading parts, so the cost is a few multiplications of the full size
+BigInteger isqrt(const BigInteger &x);
+
+// (s, x - s^2) for s = isqrt(x)
+std::pair<BigInteger, BigInteger> isqrtRem(const BigInteger &x);
+
+// The k-th root of x rounded toward zero, for k >= 1; x may be negative when k is odd
+BigInteger iroot(const BigInteger &x, unsigned k);
+
+// Whether x is the square of an integer. Most non-squares are rejected by
+// their residues modulo 64 and a few small primes, without a square root.
+bool isPerfectSquare(const BigInteger &x);
+
+// Whether n is probably prime: trial division by the small primes, then
+// Miller-Rabin tests to base 2 and rounds - 1 random bases, each a modular
+// exponentiation in a Montgomery context. bailliePSW adds a strong Lucas
+// test with Selfridge's parameters, which together with the base 2 test
+// makes the Baillie-PSW test, with no known counterexample. Exact for
+// n < 2^64 whatever the arguments.
+bool isProbablePrime(const BigInteger &n, unsigned rounds = 25, bool bailliePSW = false);
+
+// The smallest probable prime above n, the candidates sieved by the small
+// primes a window at a time
+BigInteger nextPrime(const BigInteger &n, unsigned rounds = 25);
+
+// The probable primes in [from, to), in increasing order. The range is
+// sieved by the small primes one segment at a time, and the candidates left
+// in a segment are tested on all the threads BigInteger::setParallelism()
+// has set up.
+std::vector<BigInteger> primesInRange(const BigInteger &from, const BigInteger &to, unsigned rounds = 25);
+
+// The same for Integer, on single words while both arguments fit in a long long
+Integer gcd(const Integer &a, const Integer &b);
+
+Integer lcm(const Integer &a, const Integer &b);
+
+std::tuple<Integer, Integer, Integer> extendedGcd(const Integer &a, const Integer &b);
+
+Integer modInverse(const Integer &a, const Integer &modulus);
+
+#endif //BIGINTEGER_NUMBERTHEORY_H
@@ -0,0 +1,41 @@
+#include "LimbArithmetic.h"
+#include "ThreadPool.h"
+
+#include <memory>
+
+namespace limbs {
+
+namespace {
+    struct Parallelism {
+        std::unique_ptr<ThreadPool> pool;
+        size_t cutoff = 0;
+    };
+
+    Parallelism &parallelism() {
+        static Parallelism instance;
+        return instance;
+    }
+}
+
+void set_parallelism(size_t threads, size_t cutoff) {
+    Parallelism &config = parallelism();
+    config.pool.reset();
+    if (threads > 1) config.pool = std::make_unique<ThreadPool>(threads);
+    config.cutoff = cutoff;
+}
+
+bool use_parallel(size_t n) {
+    const Parallelism &config = parallelism();
+    return config.pool != nullptr && n >= config.cutoff;
+}
+
+void parallel_for(bool parallel, size_t count, const std::function<void(size_t)> &body) {
+    ThreadPool *pool = parallelism().pool.get();
+    if (parallel && pool != nullptr) {
+        pool->parallel_for(count, body);
+    } else {
+        for (size_t i = 0; i < count; ++i) body(i);
+    }
+}
+
+}
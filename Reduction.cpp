@@ -0,0 +1,127 @@
+#include "Reduction.h"
+#include "LimbArithmetic.h"
+
+#include <algorithm>
+
+using limbs::limb_t;
+
+// Product, sum and remainder trees, on BigInteger's limbs
+class Reduction {
+public:
+    static BigInteger product(std::vector<const BigInteger *> values) {
+        bool negative = false;
+        for (const BigInteger *value: values) {
+            if (value->data.empty()) return {};
+            negative ^= value->negative;
+        }
+        if (values.empty()) return 1;
+        std::vector<BigInteger> level;
+        while (values.size() > 1) {
+            std::stable_sort(values.begin(), values.end(), [](const BigInteger *a, const BigInteger *b) {
+                return a->data.size() < b->data.size();
+            });
+            level = multiplyPairs(values);
+            values.clear();
+            for (const BigInteger &value: level) values.push_back(&value);
+        }
+        BigInteger result = magnitude(*values[0]);
+        result.negative = negative;
+        return result;
+    }
+
+    static BigInteger sum(const std::vector<const BigInteger *> &values) {
+        size_t length = 0;
+        for (const BigInteger *value: values) length = std::max(length, value->data.size());
+        // Sums of the positive and of the negative values. The carry out of
+        // an n-limb value is not propagated but counted in carries[n], which
+        // cannot overflow before 2^64 values.
+        std::vector<limb_t> limbSums[2], carries[2];
+        for (const BigInteger *value: values) {
+            if (value->data.empty()) continue;
+            std::vector<limb_t> &low = limbSums[value->negative], &high = carries[value->negative];
+            if (low.empty()) {
+                low.resize(length);
+                high.resize(length + 1);
+            }
+            size_t n = value->data.size();
+            high[n] += limbs::add_n(low.data(), low.data(), value->data.data(), n);
+        }
+        BigInteger parts[2];
+        for (int side = 0; side < 2; ++side) {
+            if (limbSums[side].empty()) continue;
+            LimbVector &r = parts[side].data;
+            r.resize(length + 1);
+            std::copy(limbSums[side].begin(), limbSums[side].end(), r.data());
+            limbs::add(r.data(), r.data(), length + 1, carries[side].data(), length + 1);
+            parts[side].normalize();
+        }
+        parts[0] -= parts[1];
+        return std::move(parts[0]);
+    }
+
+    static std::vector<BigInteger> remainders(const BigInteger &x, const std::vector<BigInteger> &moduli) {
+        if (moduli.empty()) return {};
+        // tree[0] holds the moduli's magnitudes, tree[k + 1] the products of neighbouring pairs in tree[k]
+        std::vector<std::vector<BigInteger>> tree(1);
+        for (const BigInteger &modulus: moduli) {
+            if (modulus.data.empty()) throw std::runtime_error("Division by zero");
+            tree[0].push_back(magnitude(modulus));
+        }
+        while (tree.back().size() > 1) {
+            std::vector<const BigInteger *> level;
+            for (const BigInteger &value: tree.back()) level.push_back(&value);
+            tree.push_back(multiplyPairs(level));
+        }
+
+        std::vector<BigInteger> reduced{magnitude(x) % tree.back()[0]};
+        for (size_t k = tree.size() - 1; k-- > 0;) {
+            std::vector<BigInteger> next(tree[k].size());
+            for (size_t j = 0; j < next.size(); ++j) {
+                // An odd node out was carried up unchanged, so its remainder is done
+                bool carried = j + 1 == next.size() && j % 2 == 0;
+                next[j] = carried ? std::move(reduced[j / 2]) : reduced[j / 2] % tree[k][j];
+            }
+            reduced = std::move(next);
+        }
+        for (BigInteger &remainder: reduced) remainder.negative = x.negative && !remainder.data.empty();
+        return reduced;
+    }
+
+private:
+    static BigInteger magnitude(const BigInteger &x) {
+        BigInteger result(x);
+        result.negative = false;
+        return result;
+    }
+
+    // The magnitudes of level[0] level[1], level[2] level[3] and so on, and
+    // of the last value when there is an odd one out
+    static std::vector<BigInteger> multiplyPairs(const std::vector<const BigInteger *> &level) {
+        size_t pairs = level.size() / 2, limbCount = 0;
+        std::vector<BigInteger> products(pairs + level.size() % 2);
+        // The limbs are allocated here, as the pool's threads may only write into the caller's memory
+        for (size_t i = 0; i < pairs; ++i) {
+            products[i].data.resize(level[2 * i]->data.size() + level[2 * i + 1]->data.size());
+            limbCount += products[i].data.size();
+        }
+        if (level.size() % 2 != 0) products.back() = magnitude(*level.back());
+        limbs::parallel_for(limbs::use_parallel(limbCount), pairs, [&](size_t i) {
+            const BigInteger &a = *level[2 * i], &b = *level[2 * i + 1];
+            BigInteger::multiplyLimbs(products[i].data, a.data.data(), a.data.size(), b.data.data(), b.data.size());
+            products[i].normalize();
+        });
+        return products;
+    }
+};
+
+BigInteger product(std::vector<const BigInteger *> values) {
+    return Reduction::product(std::move(values));
+}
+
+BigInteger sum(const std::vector<const BigInteger *> &values) {
+    return Reduction::sum(values);
+}
+
+std::vector<BigInteger> remainders(const BigInteger &x, const std::vector<BigInteger> &moduli) {
+    return Reduction::remainders(x, moduli);
+}
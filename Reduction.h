@@ -0,0 +1,53 @@
+#ifndef BIGINTEGER_REDUCTION_H
+#define BIGINTEGER_REDUCTION_H
+
+#include "BigInteger.h"
+
+#include <iterator>
+#include <vector>
+
+// Product of the values pointed to, 1 for none. The values are sorted by
+// length and multiplied in neighbouring pairs, level by level up a balanced
+// tree, so the large products are of operands of about the same length.
+// With BigInteger::setParallelism(), the products of each level are spread
+// over the pool.
+BigInteger product(std::vector<const BigInteger *> values);
+
+// Sum of the values pointed to, 0 for none. The limbs are added into one
+// buffer for the positive values and one for the negative ones, with the
+// carries counted aside and propagated once at the end.
+BigInteger sum(const std::vector<const BigInteger *> &values);
+
+// The same over [first, last) and over any range of BigInteger
+template<typename Iterator>
+BigInteger product(Iterator first, Iterator last) {
+    std::vector<const BigInteger *> values;
+    for (; first != last; ++first) values.push_back(&*first);
+    return product(std::move(values));
+}
+
+template<typename Range>
+BigInteger product(const Range &values) {
+    return product(std::begin(values), std::end(values));
+}
+
+template<typename Iterator>
+BigInteger sum(Iterator first, Iterator last) {
+    std::vector<const BigInteger *> values;
+    for (; first != last; ++first) values.push_back(&*first);
+    return sum(values);
+}
+
+template<typename Range>
+BigInteger sum(const Range &values) {
+    return sum(std::begin(values), std::end(values));
+}
+
+// x % moduli[i] for every i, with the sign of x like operator%. A product
+// tree of the moduli is built first and x is reduced down it, by the
+// product of all the moduli, then of each half and so on, so that each
+// modulus only divides a remainder about its own size. Throws when a
+// modulus is zero.
+std::vector<BigInteger> remainders(const BigInteger &x, const std::vector<BigInteger> &moduli);
+
+#endif //BIGINTEGER_REDUCTION_H
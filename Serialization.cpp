@@ -0,0 +1,201 @@
+#include "Serialization.h"
+#include "LimbArithmetic.h"
+
+#include <cstring>
+
+using limbs::limb_t;
+
+namespace {
+    constexpr size_t LIMB_BYTES = sizeof(limb_t);
+
+    // A 64-bit limb count takes at most this many varint bytes
+    constexpr size_t MAX_VARINT_BYTES = 10;
+
+    constexpr bool LITTLE_ENDIAN_HOST = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+
+    size_t varintSize(uint64_t value) {
+        size_t bytes = 1;
+        while (value >= 0x80) {
+            value >>= 7;
+            ++bytes;
+        }
+        return bytes;
+    }
+
+    size_t headerSize(uint64_t limbCount) {
+        return (2 + varintSize(limbCount) + LIMB_BYTES - 1) / LIMB_BYTES * LIMB_BYTES;
+    }
+
+    limb_t toLittleEndian(limb_t limb) {
+        return LITTLE_ENDIAN_HOST ? limb : __builtin_bswap64(limb);
+    }
+
+    limb_t loadLimb(const unsigned char *bytes) {
+        limb_t limb;
+        std::memcpy(&limb, bytes, LIMB_BYTES);
+        return toLittleEndian(limb);
+    }
+
+    struct Header {
+        bool negative;
+        size_t limbCount;
+        // Offset of the limbs
+        size_t size;
+    };
+
+    // Checks the record at bytes[0..size), limbs included, and returns its header
+    Header readHeader(const unsigned char *bytes, size_t size) {
+        if (size < 3) throw std::runtime_error("Truncated BigInteger record");
+        if (bytes[0] != SERIALIZATION_VERSION) throw std::runtime_error("Unsupported BigInteger record version");
+        if (bytes[1] > 1) throw std::runtime_error("Malformed BigInteger record");
+        Header header{bytes[1] == 1, 0, 0};
+
+        uint64_t count = 0;
+        size_t i = 2;
+        for (unsigned shift = 0;; shift += 7) {
+            if (i >= size) throw std::runtime_error("Truncated BigInteger record");
+            if (i - 2 == MAX_VARINT_BYTES) throw std::runtime_error("Malformed BigInteger record");
+            uint64_t byte = bytes[i++];
+            if (shift == 63 && byte > 1) throw std::runtime_error("Malformed BigInteger record");
+            count |= (byte & 0x7f) << shift;
+            if (byte < 0x80) break;
+        }
+        // Only the shortest encoding of the count is valid
+        if (i - 2 != varintSize(count)) throw std::runtime_error("Malformed BigInteger record");
+        header.size = headerSize(count);
+        if (size < header.size || (size - header.size) / LIMB_BYTES < count) {
+            throw std::runtime_error("Truncated BigInteger record");
+        }
+        for (; i < header.size; ++i) {
+            if (bytes[i] != 0) throw std::runtime_error("Malformed BigInteger record");
+        }
+        header.limbCount = static_cast<size_t>(count);
+        bool normalized = count > 0 ? loadLimb(bytes + header.size + (count - 1) * LIMB_BYTES) != 0 : !header.negative;
+        if (!normalized) throw std::runtime_error("Malformed BigInteger record");
+        return header;
+    }
+}
+
+BigIntegerView::BigIntegerView(const uint64_t *limbs, size_t size, bool negative)
+        : negative(negative), limbs(limbs), length(size) {
+    if ((size > 0 && limbs[size - 1] == 0) || (size == 0 && negative)) {
+        throw std::runtime_error("Limbs of a view must be normalized");
+    }
+}
+
+BigIntegerView BigIntegerView::fromSerialized(const void *buffer, size_t size, size_t *consumed) {
+    if (!LITTLE_ENDIAN_HOST) throw std::runtime_error("BigIntegerView needs a little-endian host");
+    if (reinterpret_cast<uintptr_t>(buffer) % alignof(limb_t) != 0) {
+        throw std::runtime_error("BigInteger record is not 8-byte aligned");
+    }
+    const auto *bytes = static_cast<const unsigned char *>(buffer);
+    Header header = readHeader(bytes, size);
+    if (consumed) *consumed = header.size + header.limbCount * LIMB_BYTES;
+    return {reinterpret_cast<const limb_t *>(bytes + header.size), header.limbCount, header.negative};
+}
+
+size_t BigIntegerView::bitLength() const {
+    if (length == 0) return 0;
+    return length * limbs::LIMB_BITS - __builtin_clzll(limbs[length - 1]);
+}
+
+BigInteger BigIntegerView::toBigInteger() const {
+    BigInteger x;
+    x.data.assign(limbs, limbs + length);
+    x.negative = negative;
+    return x;
+}
+
+std::string BigIntegerView::toString() const {
+    if (length == 0) return "0";
+    std::string digits = limbs::to_decimal(limbs, length);
+    return negative ? "-" + digits : digits;
+}
+
+int compare(BigIntegerView a, BigIntegerView b) {
+    if (a.negative != b.negative) return a.negative ? -1 : 1;
+    int magnitude = a.length != b.length ? (a.length < b.length ? -1 : 1) : limbs::cmp(a.limbs, b.limbs, a.length);
+    return a.negative ? -magnitude : magnitude;
+}
+
+BigInteger BigIntegerView::sum(BigIntegerView a, BigIntegerView b, bool subtract) {
+    BigInteger result = a.toBigInteger();
+    result.addSigned(b.limbs, b.length, b.negative != subtract);
+    return result;
+}
+
+BigInteger BigIntegerView::product(BigIntegerView a, BigIntegerView b) {
+    BigInteger result;
+    if (a.length == 0 || b.length == 0) return result;
+    BigInteger::multiplyLimbs(result.data, a.limbs, a.length, b.limbs, b.length);
+    result.negative = a.negative != b.negative;
+    result.normalize();
+    return result;
+}
+
+void BigIntegerView::divide(BigIntegerView a, BigIntegerView b, BigInteger &quotient, BigInteger &remainder) {
+    BigInteger::divideLimbs(a.limbs, a.length, a.negative, b.limbs, b.length, b.negative, quotient, remainder);
+}
+
+BigInteger operator/(BigIntegerView a, BigIntegerView b) {
+    BigInteger quotient, remainder;
+    BigIntegerView::divide(a, b, quotient, remainder);
+    return quotient;
+}
+
+BigInteger operator%(BigIntegerView a, BigIntegerView b) {
+    BigInteger quotient, remainder;
+    BigIntegerView::divide(a, b, quotient, remainder);
+    return remainder;
+}
+
+size_t serializedSize(BigIntegerView x) {
+    return headerSize(x.size()) + x.size() * LIMB_BYTES;
+}
+
+size_t serialize(BigIntegerView x, void *buffer, size_t capacity) {
+    size_t header = headerSize(x.size()), total = header + x.size() * LIMB_BYTES;
+    if (capacity < total) throw std::runtime_error("Buffer too small for the BigInteger record");
+    auto *bytes = static_cast<unsigned char *>(buffer);
+    bytes[0] = SERIALIZATION_VERSION;
+    bytes[1] = x.isNegative() ? 1 : 0;
+    size_t i = 2;
+    uint64_t count = x.size();
+    for (; count >= 0x80; count >>= 7) bytes[i++] = static_cast<unsigned char>(count | 0x80);
+    bytes[i++] = static_cast<unsigned char>(count);
+    std::memset(bytes + i, 0, header - i);
+    if (LITTLE_ENDIAN_HOST) {
+        std::memcpy(bytes + header, x.data(), x.size() * LIMB_BYTES);
+    } else {
+        for (size_t k = 0; k < x.size(); ++k) {
+            limb_t limb = toLittleEndian(x.data()[k]);
+            std::memcpy(bytes + header + k * LIMB_BYTES, &limb, LIMB_BYTES);
+        }
+    }
+    return total;
+}
+
+std::string serialize(BigIntegerView x) {
+    std::string out(serializedSize(x), '\0');
+    serialize(x, out.data(), out.size());
+    return out;
+}
+
+BigInteger deserialize(const void *buffer, size_t size, size_t *consumed) {
+    const auto *bytes = static_cast<const unsigned char *>(buffer);
+    Header header = readHeader(bytes, size);
+    if (consumed) *consumed = header.size + header.limbCount * LIMB_BYTES;
+    return BigIntegerView::load(bytes + header.size, header.limbCount, header.negative);
+}
+
+BigInteger BigIntegerView::load(const unsigned char *bytes, size_t count, bool negative) {
+    BigInteger x;
+    x.data.resize(count);
+    if (LITTLE_ENDIAN_HOST) {
+        std::memcpy(x.data.data(), bytes, count * LIMB_BYTES);
+    } else {
+        for (size_t k = 0; k < count; ++k) x.data[k] = loadLimb(bytes + k * LIMB_BYTES);
+    }
+    x.negative = negative;
+    return x;
+}
@@ -0,0 +1,113 @@
+#ifndef BIGINTEGER_SERIALIZATION_H
+#define BIGINTEGER_SERIALIZATION_H
+
+#include "BigInteger.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Binary records of BigInteger values, version 1:
+//
+//   byte 0       format version, 1
+//   byte 1       sign, 0 for zero and positive values, 1 for negative ones
+//   bytes 2..    limb count n as an unsigned LEB128 varint
+//   padding      zero bytes up to the next multiple of 8 from the record start
+//   8 n bytes    the magnitude's limbs, least significant first, each little-endian
+//
+// The top limb is non-zero and zero has n = 0 and sign 0, so every value has
+// exactly one record. Thanks to the padding, the limbs of a record that
+// starts 8-byte aligned are themselves aligned, so a BigIntegerView can use
+// them in place.
+constexpr uint8_t SERIALIZATION_VERSION = 1;
+
+// Read-only BigInteger over limbs that live elsewhere: a serialized record
+// in an mmap'd file or a network buffer, or a BigInteger. It works as an
+// operand of comparisons and arithmetic without copying the limbs, and must
+// not outlive them.
+class BigIntegerView {
+public:
+    BigIntegerView(const BigInteger &x) : negative(x.negative), limbs(x.data.data()), length(x.data.size()) {}
+
+    // Throws unless limbs[size - 1] is non-zero and a zero is not negative
+    BigIntegerView(const uint64_t *limbs, size_t size, bool negative);
+
+    // The record at the start of buffer[0..size), which must be 8-byte
+    // aligned; consumed, if given, gets the record's length. Throws for a
+    // malformed or truncated record, and on big-endian hosts, where the
+    // limbs are not in native order (deserialize() works there).
+    static BigIntegerView fromSerialized(const void *buffer, size_t size, size_t *consumed = nullptr);
+
+    [[nodiscard]] bool isNegative() const { return negative; }
+
+    // Limbs of the magnitude, least significant first, without high zero limbs
+    [[nodiscard]] const uint64_t *data() const { return limbs; }
+
+    [[nodiscard]] size_t size() const { return length; }
+
+    [[nodiscard]] size_t bitLength() const;
+
+    [[nodiscard]] BigInteger toBigInteger() const;
+
+    [[nodiscard]] std::string toString() const;
+
+    // -1, 0 or 1 as a is below, equal to or above b
+    friend int compare(BigIntegerView a, BigIntegerView b);
+
+    friend bool operator==(BigIntegerView a, BigIntegerView b) { return compare(a, b) == 0; }
+
+    friend bool operator!=(BigIntegerView a, BigIntegerView b) { return compare(a, b) != 0; }
+
+    friend bool operator<(BigIntegerView a, BigIntegerView b) { return compare(a, b) < 0; }
+
+    friend bool operator>(BigIntegerView a, BigIntegerView b) { return compare(a, b) > 0; }
+
+    friend bool operator<=(BigIntegerView a, BigIntegerView b) { return compare(a, b) <= 0; }
+
+    friend bool operator>=(BigIntegerView a, BigIntegerView b) { return compare(a, b) >= 0; }
+
+    // Same results as the BigInteger operators, truncating division included
+    friend BigInteger operator+(BigIntegerView a, BigIntegerView b) { return sum(a, b, false); }
+
+    friend BigInteger operator-(BigIntegerView a, BigIntegerView b) { return sum(a, b, true); }
+
+    friend BigInteger operator*(BigIntegerView a, BigIntegerView b) { return product(a, b); }
+
+    friend BigInteger operator/(BigIntegerView a, BigIntegerView b);
+
+    friend BigInteger operator%(BigIntegerView a, BigIntegerView b);
+
+private:
+    bool negative;
+    const uint64_t *limbs;
+    size_t length;
+
+    // a + b, or a - b for subtract
+    static BigInteger sum(BigIntegerView a, BigIntegerView b, bool subtract);
+
+    static BigInteger product(BigIntegerView a, BigIntegerView b);
+
+    static void divide(BigIntegerView a, BigIntegerView b, BigInteger &quotient, BigInteger &remainder);
+
+    // The value of count little-endian limbs at bytes, checked already
+    static BigInteger load(const unsigned char *bytes, size_t count, bool negative);
+
+    friend BigInteger deserialize(const void *buffer, size_t size, size_t *consumed);
+};
+
+// Length of the record of x
+size_t serializedSize(BigIntegerView x);
+
+// Writes the record of x to buffer[0..capacity) and returns its length;
+// throws when it does not fit
+size_t serialize(BigIntegerView x, void *buffer, size_t capacity);
+
+// The record of x as a string of bytes
+std::string serialize(BigIntegerView x);
+
+// Reads the record at the start of buffer[0..size), which needs no
+// alignment; consumed, if given, gets the record's length. Throws for a
+// malformed or truncated record or an unknown version.
+BigInteger deserialize(const void *buffer, size_t size, size_t *consumed = nullptr);
+
+#endif //BIGINTEGER_SERIALIZATION_H
@@ -0,0 +1,110 @@
+#include "ThreadPool.h"
+
+#include <exception>
+
+struct ThreadPool::Batch {
+    const std::function<void(size_t)> *body;
+    std::atomic<size_t> pending;
+    std::mutex errorMutex;
+    std::exception_ptr error;
+};
+
+namespace {
+    // The pool and queue the current thread works for, if it is a worker
+    thread_local const ThreadPool *currentPool = nullptr;
+    thread_local size_t currentQueue = 0;
+}
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) threads = 1;
+    for (size_t i = 0; i < threads; ++i) queues.push_back(std::make_unique<Queue>());
+    for (size_t i = 1; i < threads; ++i) workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (std::thread &worker: workers) worker.join();
+}
+
+size_t ThreadPool::homeQueue() const {
+    return currentPool == this ? currentQueue : 0;
+}
+
+void ThreadPool::run(const Task &task) {
+    Batch &batch = *task.batch;
+    try {
+        (*batch.body)(task.index);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(batch.errorMutex);
+        if (!batch.error) batch.error = std::current_exception();
+    }
+    // The waiting thread may destroy the batch as soon as this lands
+    batch.pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+bool ThreadPool::runOne(size_t home) {
+    if (queued.load(std::memory_order_acquire) == 0) return false;
+    for (size_t i = 0; i < queues.size(); ++i) {
+        size_t index = (home + i) % queues.size();
+        Queue &queue = *queues[index];
+        std::unique_lock<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) continue;
+        // Newest task from our own deque, oldest (and largest) from others'
+        Task task;
+        if (i == 0) {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+        } else {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+        }
+        lock.unlock();
+        queued.fetch_sub(1, std::memory_order_acq_rel);
+        run(task);
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)> &body) {
+    if (count == 0) return;
+    if (count == 1 || workers.empty()) {
+        for (size_t i = 0; i < count; ++i) body(i);
+        return;
+    }
+
+    Batch batch;
+    batch.body = &body;
+    batch.pending.store(count, std::memory_order_relaxed);
+    size_t home = homeQueue();
+    {
+        std::lock_guard<std::mutex> lock(queues[home]->mutex);
+        for (size_t i = count; i-- > 1;) queues[home]->tasks.push_back({&batch, i});
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queued.fetch_add(count - 1, std::memory_order_acq_rel);
+    }
+    wakeUp.notify_all();
+
+    run({&batch, 0});
+    while (batch.pending.load(std::memory_order_acquire) != 0) {
+        if (!runOne(home)) std::this_thread::yield();
+    }
+    if (batch.error) std::rethrow_exception(batch.error);
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentQueue = index;
+    while (true) {
+        if (runOne(index)) continue;
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeUp.wait(lock, [this] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+        if (stopping) return;
+    }
+}
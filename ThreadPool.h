@@ -0,0 +1,67 @@
+#ifndef BIGINTEGER_THREADPOOL_H
+#define BIGINTEGER_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fork-join pool with one task deque per thread. A thread pushes the tasks
+// it forks onto its own deque and takes them back from the same end, while
+// idle threads steal from the other end of everyone else's. A thread that
+// waits for its tasks keeps running queued ones meanwhile, so parallel_for
+// may be called from inside a task without tying up the pool.
+class ThreadPool {
+public:
+    // threads counts the thread calling parallel_for, so threads - 1 workers are started
+    explicit ThreadPool(size_t threads);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    [[nodiscard]] size_t size() const { return workers.size() + 1; }
+
+    // Calls body(i) for every i < count and returns once all calls have
+    // finished, rethrowing the first exception any of them threw
+    void parallel_for(size_t count, const std::function<void(size_t)> &body);
+
+private:
+    struct Batch;
+
+    struct Task {
+        Batch *batch;
+        size_t index;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // queues[0] is shared by the threads outside the pool
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> queued{0};
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    bool stopping = false;
+
+    [[nodiscard]] size_t homeQueue() const;
+
+    // Runs one queued task, preferring the home queue; false if none was found
+    bool runOne(size_t home);
+
+    static void run(const Task &task);
+
+    void workerLoop(size_t index);
+};
+
+#endif //BIGINTEGER_THREADPOOL_H
@@ -0,0 +1,313 @@
+// Benchmarks of the BigInteger and Integer operators over a sweep of operand
+// sizes, written as JSON, and a comparison of two such runs.
+//
+//   bigint_bench [--max-digits N] [--min-time MS] [--filter TEXT] [--threads N] [--output FILE]
+//   bigint_bench compare BASELINE.json CANDIDATE.json [--threshold FRACTION]
+//
+// Each result gives the time per operation, the throughput in decimal digits
+// of operand per second, and the heap allocations per operation, counted by
+// replacing the global operator new, both the plain and the aligned forms:
+// std::pmr::new_delete_resource(), behind the limb storage, the promoted
+// BigInteger of an Integer and the scratch pools, allocates with the
+// aligned one. compare prints the change of every result the two runs
+// share and exits with status 1 when any got slower, or allocates more, by
+// more than the threshold (default 0.1, i.e. 10%).
+
+#include "BigInteger.h"
+#include "Integer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    std::atomic<size_t> allocationCount{0};
+    std::atomic<size_t> allocatedBytes{0};
+}
+
+void *operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t size, std::align_val_t alignment) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    // aligned_alloc wants a multiple of the alignment
+    auto align = std::max(static_cast<size_t>(alignment), sizeof(void *));
+    if (void *p = std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Operand sizes of the sweep, in decimal digits; 19 digits fit in one limb
+    constexpr size_t SIZES[] = {19, 100, 1000, 10000, 100000, 1000000, 10000000};
+
+    // Keeps results alive so the timed operations are not optimized away
+    volatile size_t sink;
+
+    struct Options {
+        size_t maxDigits = 10000000;
+        double minTime = 0.2;
+        std::string filter;
+        size_t threads = 1;
+        std::string output;
+    };
+
+    struct Result {
+        std::string name;
+        size_t digits = 0;
+        size_t iterations = 0;
+        double nsPerOp = 0;
+        double allocationsPerOp = 0;
+        double bytesPerOp = 0;
+    };
+
+    class Runner {
+    public:
+        explicit Runner(const Options &options) : options(options) {}
+
+        // Times op, repeating it until the batch takes at least minTime
+        template<typename Op>
+        void run(const std::string &name, size_t digits, Op &&op) {
+            if (!options.filter.empty() && name.find(options.filter) == std::string::npos) return;
+            op();
+            size_t iterations = 1;
+            while (true) {
+                size_t count = allocationCount.load(), bytes = allocatedBytes.load();
+                auto start = Clock::now();
+                for (size_t i = 0; i < iterations; ++i) op();
+                double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+                if (elapsed >= options.minTime) {
+                    Result result;
+                    result.name = name;
+                    result.digits = digits;
+                    result.iterations = iterations;
+                    result.nsPerOp = elapsed * 1e9 / static_cast<double>(iterations);
+                    result.allocationsPerOp = static_cast<double>(allocationCount.load() - count) / static_cast<double>(iterations);
+                    result.bytesPerOp = static_cast<double>(allocatedBytes.load() - bytes) / static_cast<double>(iterations);
+                    std::cerr << name << " " << digits << ": " << result.nsPerOp << " ns/op\n";
+                    results.push_back(result);
+                    return;
+                }
+                // Aim a little past minTime, growing at most 100 times per step
+                double factor = elapsed > 0 ? options.minTime / elapsed * 1.2 : 100;
+                iterations = static_cast<size_t>(static_cast<double>(iterations) * std::clamp(factor, 2.0, 100.0));
+            }
+        }
+
+        // The result of name at digits, null if it was not run
+        [[nodiscard]] const Result *find(const std::string &name, size_t digits) const {
+            for (const Result &r: results) {
+                if (r.name == name && r.digits == digits) return &r;
+            }
+            return nullptr;
+        }
+
+        void write(std::ostream &out) const {
+            out << "{\n  \"benchmark\": \"bigint_bench\",\n  \"min_time_ms\": " << options.minTime * 1000
+                << ",\n  \"threads\": " << options.threads << ",\n  \"results\": [\n";
+            for (size_t i = 0; i < results.size(); ++i) {
+                const Result &r = results[i];
+                double digitsPerSecond = static_cast<double>(r.digits) * 1e9 / r.nsPerOp;
+                char line[512];
+                std::snprintf(line, sizeof(line),
+                              "    {\"name\": \"%s\", \"digits\": %zu, \"iterations\": %zu, \"ns_per_op\": %.3f, "
+                              "\"digits_per_sec\": %.6g, \"allocs_per_op\": %.3f, \"bytes_per_op\": %.1f}%s\n",
+                              r.name.c_str(), r.digits, r.iterations, r.nsPerOp, digitsPerSecond,
+                              r.allocationsPerOp, r.bytesPerOp, i + 1 == results.size() ? "" : ",");
+                out << line;
+            }
+            out << "  ]\n}\n";
+        }
+
+    private:
+        const Options &options;
+        std::vector<Result> results;
+    };
+
+    std::string randomDigits(size_t digits, std::mt19937_64 &random) {
+        std::string s(digits, '0');
+        for (char &c: s) c = static_cast<char>('0' + random() % 10);
+        s[0] = static_cast<char>('1' + random() % 9);
+        return s;
+    }
+
+    void benchBigInteger(Runner &runner, size_t digits, std::mt19937_64 &random) {
+        std::string text = randomDigits(digits, random);
+        BigInteger a(text), b(randomDigits(digits, random));
+        BigInteger dividend(randomDigits(2 * digits, random));
+        BigInteger c = a + BigInteger::ONE();
+        size_t shift = 64 * 3 + 17;
+
+        runner.run("parse", digits, [&] { sink = BigInteger(text).bitLength(); });
+        runner.run("toString", digits, [&] { sink = a.toString().size(); });
+        runner.run("add", digits, [&] { sink = (a + b).bitLength(); });
+        runner.run("sub", digits, [&] { sink = (a - b).bitLength(); });
+        runner.run("mul", digits, [&] { sink = (a * b).bitLength(); });
+        runner.run("div", digits, [&] { sink = (dividend / a).bitLength(); });
+        runner.run("mod", digits, [&] { sink = (dividend % a).bitLength(); });
+        runner.run("shl", digits, [&] { sink = (a << shift).bitLength(); });
+        runner.run("shr", digits, [&] { sink = (a >> shift).bitLength(); });
+        // Operands that differ only in the lowest limb, so the whole length is compared
+        runner.run("compare", digits, [&] { sink = a < c; });
+        runner.run("equal", digits, [&] { sink = a == c; });
+    }
+
+    // Integer stays on a long long until a result overflows, so these are
+    // single-limb operations, half of them crossing over to BigInteger
+    void benchInteger(Runner &runner, std::mt19937_64 &random) {
+        long long x = static_cast<long long>(random() >> 34), y = static_cast<long long>(random() >> 34);
+        long long large = std::numeric_limits<long long>::max() - 5;
+        Integer small1(x), small2(y), big(large), huge = Integer(large) * Integer(large);
+
+        runner.run("BigInteger.fromLongLong", 19, [&] { sink = BigInteger(x).bitLength(); });
+        runner.run("Integer.add.small", 19, [&] { sink = (small1 + small2).usingBigInteger(); });
+        runner.run("Integer.add.overflow", 19, [&] { sink = (big + big).usingBigInteger(); });
+        runner.run("Integer.mul.small", 19, [&] { sink = (small1 * small2).usingBigInteger(); });
+        runner.run("Integer.mul.overflow", 19, [&] { sink = (big * big).usingBigInteger(); });
+        runner.run("Integer.div.small", 19, [&] { sink = (big / small1).usingBigInteger(); });
+        runner.run("Integer.div.demote", 19, [&] { sink = (huge / big).usingBigInteger(); });
+        runner.run("Integer.compare", 19, [&] { sink = small1 < small2; });
+    }
+
+    int runBenchmarks(const Options &options) {
+        if (options.threads > 1) BigInteger::setParallelism(options.threads);
+        std::mt19937_64 random(2024);
+        Runner runner(options);
+        benchInteger(runner, random);
+        for (size_t digits: SIZES) {
+            if (digits <= options.maxDigits) benchBigInteger(runner, digits, random);
+        }
+        // A 1000-digit product is far past the inline limbs, so it has to
+        // allocate; none counted means the counting misses the library's heap
+        const Result *product = runner.find("mul", 1000);
+        if (product && product->allocationsPerOp == 0) {
+            std::cerr << "mul 1000: no allocations counted, allocs_per_op is broken\n";
+            return 2;
+        }
+        if (options.output.empty()) {
+            runner.write(std::cout);
+        } else {
+            std::ofstream out(options.output);
+            runner.write(out);
+            if (!out) {
+                std::cerr << "Cannot write " << options.output << "\n";
+                return 2;
+            }
+        }
+        return 0;
+    }
+
+    // The value of "key" in a line written by Runner::write(), quotes removed
+    std::string field(const std::string &line, const std::string &key) {
+        std::string pattern = "\"" + key + "\": ";
+        size_t start = line.find(pattern);
+        if (start == std::string::npos) return "";
+        start += pattern.size();
+        size_t end = line.find_first_of(",}", start);
+        std::string value = line.substr(start, end - start);
+        if (!value.empty() && value.front() == '"') value = value.substr(1, value.size() - 2);
+        return value;
+    }
+
+    // (ns_per_op, allocs_per_op) of every result, keyed by name and size
+    bool readResults(const std::string &path, std::map<std::pair<std::string, size_t>, std::pair<double, double>> &results) {
+        std::ifstream in(path);
+        if (!in) {
+            std::cerr << "Cannot read " << path << "\n";
+            return false;
+        }
+        std::string line;
+        while (std::getline(in, line)) {
+            std::string name = field(line, "name");
+            if (name.empty()) continue;
+            results[{name, std::stoull(field(line, "digits"))}] =
+                    {std::stod(field(line, "ns_per_op")), std::stod(field(line, "allocs_per_op"))};
+        }
+        return true;
+    }
+
+    int compare(const std::string &baselinePath, const std::string &candidatePath, double threshold) {
+        std::map<std::pair<std::string, size_t>, std::pair<double, double>> baseline, candidate;
+        if (!readResults(baselinePath, baseline) || !readResults(candidatePath, candidate)) return 2;
+        size_t regressions = 0;
+        std::printf("%-26s %10s %14s %14s %9s\n", "name", "digits", "baseline ns", "candidate ns", "change");
+        for (const auto &[key, after]: candidate) {
+            auto found = baseline.find(key);
+            if (found == baseline.end()) continue;
+            const auto &before = found->second;
+            double change = after.first / before.first - 1;
+            bool slower = change > threshold;
+            bool moreAllocations = after.second > before.second * (1 + threshold) && after.second >= before.second + 1;
+            const char *verdict = slower ? "  REGRESSION" : change < -threshold ? "  improved" : "";
+            std::printf("%-26s %10zu %14.1f %14.1f %+8.1f%%%s%s\n", key.first.c_str(), key.second,
+                        before.first, after.first, change * 100, verdict,
+                        moreAllocations ? "  MORE ALLOCATIONS" : "");
+            if (slower || moreAllocations) ++regressions;
+        }
+        std::printf("%zu regression(s) beyond %.1f%%\n", regressions, threshold * 100);
+        return regressions == 0 ? 0 : 1;
+    }
+
+    int usage() {
+        std::cerr << "usage: bigint_bench [--max-digits N] [--min-time MS] [--filter TEXT] [--threads N] [--output FILE]\n"
+                     "       bigint_bench compare BASELINE.json CANDIDATE.json [--threshold FRACTION]\n";
+        return 2;
+    }
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    try {
+        if (!args.empty() && args[0] == "compare") {
+            if (args.size() != 3 && !(args.size() == 5 && args[3] == "--threshold")) return usage();
+            return compare(args[1], args[2], args.size() == 5 ? std::stod(args[4]) : 0.1);
+        }
+        Options options;
+        for (size_t i = 0; i < args.size(); i += 2) {
+            if (i + 1 >= args.size()) return usage();
+            const std::string &flag = args[i], &value = args[i + 1];
+            if (flag == "--max-digits") options.maxDigits = std::stoull(value);
+            else if (flag == "--min-time") options.minTime = std::stod(value) / 1000;
+            else if (flag == "--filter") options.filter = value;
+            else if (flag == "--threads") options.threads = std::stoull(value);
+            else if (flag == "--output") options.output = value;
+            else return usage();
+        }
+        return runBenchmarks(options);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n";
+        return 2;
+    }
+}